@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#include "Arena.h"
+
+Arena::Arena (size_t aBlockSize) :
+  cur (NULL), end (NULL), blockSize (aBlockSize), total (0)
+{
+}
+
+Arena::~Arena ()
+{
+  clear ();
+}
+
+void
+Arena::clear ()
+{
+  for (std::vector<char *>::iterator i = blocks.begin ();
+       i != blocks.end (); ++i)
+    delete[] *i;
+  blocks.clear ();
+  cur = end = NULL;
+  total = 0;
+}
+
+void *
+Arena::slowAllocate (size_t size, size_t align)
+{
+  /* Anything that wouldn't leave most of a block for later gets a block
+     of its own, and the current block stays in use. */
+  bool own = size + align > blockSize / 4;
+  size_t len = own ? size + align : blockSize;
+  char *b = new char[len];
+  blocks.push_back (b);
+  total += len;
+  char *p = (char *) (((size_t) b + align - 1) & ~(align - 1));
+  if (!own)
+    {
+      cur = p + size;
+      end = b + len;
+    }
+  return p;
+}
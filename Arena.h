@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#ifndef SETUP_ARENA_H
+#define SETUP_ARENA_H
+
+/* A bump allocator.
+ *
+ * Memory is handed out from large blocks in the order it is asked for, so
+ * that things built one after another - like the dependency lists of a
+ * package version - end up next to each other.  Nothing is freed
+ * individually: clear () or the destructor release all blocks at once,
+ * without running any destructors, so only objects that own no other
+ * memory (or own only arena memory) may be put here.
+ */
+
+#include <stddef.h>
+#include <new>
+#include <utility>
+#include <vector>
+
+class Arena
+{
+public:
+  Arena (size_t aBlockSize = 64 * 1024);
+  ~Arena ();
+
+  void *allocate (size_t size, size_t align)
+  {
+    size_t p = ((size_t) cur + align - 1) & ~(align - 1);
+    if (p + size > (size_t) end)
+      return slowAllocate (size, align);
+    cur = (char *) p + size;
+    return (void *) p;
+  }
+  template <class T, class... Args> T *create (Args&&... args)
+  {
+    return new (allocate (sizeof (T), alignof (T)))
+      T (std::forward<Args> (args)...);
+  }
+
+  /* Release everything allocated so far. */
+  void clear ();
+  /* Bytes taken from the system. */
+  size_t size () const { return total; }
+private:
+  Arena (Arena const &);
+  Arena &operator= (Arena const &);
+  void *slowAllocate (size_t size, size_t align);
+
+  std::vector<char *> blocks;
+  char *cur, *end;
+  size_t blockSize, total;
+};
+
+/* Lets standard containers keep their elements in an arena.  Memory
+   given back by a growing container is only reclaimed with the arena. */
+template <class T> class ArenaAllocator
+{
+public:
+  typedef T value_type;
+
+  ArenaAllocator (Arena &anArena) : arena (&anArena) {}
+  template <class U> ArenaAllocator (ArenaAllocator<U> const &rhs) :
+    arena (rhs.arena) {}
+
+  T *allocate (size_t n)
+    { return (T *) arena->allocate (n * sizeof (T), alignof (T)); }
+  void deallocate (T *, size_t) {}
+
+  template <class U> bool operator== (ArenaAllocator<U> const &rhs) const
+    { return arena == rhs.arena; }
+  template <class U> bool operator!= (ArenaAllocator<U> const &rhs) const
+    { return arena != rhs.arena; }
+
+  Arena *arena;
+};
+
+#endif /* SETUP_ARENA_H */
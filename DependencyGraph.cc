@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#include "DependencyGraph.h"
+
+const DependencyGraph::index_type DependencyGraph::none;
+
+DependencyGraph::DependencyGraph (PackageCollection &aCollection) :
+  packages (&aCollection), generation_ (0)
+{
+  clear ();
+}
+
+DependencyGraph::index_type
+DependencyGraph::add (PackageAndList const &depends)
+{
+  index_type node = nodes.size () - 1;
+  for (PackageAndList::const_iterator c = depends.begin ();
+       c != depends.end (); ++c)
+    {
+      for (PackageOrList::const_iterator a = (*c)->begin ();
+	   a != (*c)->end (); ++a)
+	{
+	  targets.push_back (packages->id ((*a)->packageName ()));
+	  specs.push_back (*a);
+	}
+      clauses.push_back (targets.size ());
+    }
+  nodes.push_back (clauses.size () - 1);
+  return node;
+}
+
+void
+DependencyGraph::clear ()
+{
+  nodes.assign (1, 0);
+  clauses.assign (1, 0);
+  targets.clear ();
+  specs.clear ();
+  ++generation_;
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#ifndef SETUP_DEPENDENCYGRAPH_H
+#define SETUP_DEPENDENCYGRAPH_H
+
+/* The depends lists of the package versions, with every package named in
+ * them looked up once, up front, instead of each time a dependency is
+ * followed.
+ *
+ * Each depends list added becomes a node.  Its AND clauses, their OR
+ * alternatives and the alternatives' package ids are kept in compressed
+ * sparse rows: the clauses of node n are [clauseBegin (n), clauseEnd (n)),
+ * the alternatives of clause c are [alternativeBegin (c), alternativeEnd
+ * (c)).  Nodes are only ever appended, so these indices stay valid while
+ * more nodes are added - which happens while the graph is being walked,
+ * when a version is reached that wasn't linked yet.
+ */
+
+#include <stdint.h>
+#include <vector>
+#include "PackageCollection.h"
+#include "PackageSpecification.h"
+
+class DependencyGraph
+{
+public:
+  typedef uint32_t index_type;
+  static const index_type none = (index_type) -1;
+
+  /* The package ids are those of packages. */
+  DependencyGraph (PackageCollection &packages);
+
+  /* Resolve depends and return its node. */
+  index_type add (PackageAndList const &depends);
+  /* Forget all nodes.  The generation changes, so a node kept from before
+     can be told from a current one. */
+  void clear ();
+  unsigned int generation () const { return generation_; }
+
+  index_type clauseBegin (index_type node) const { return nodes[node]; }
+  index_type clauseEnd (index_type node) const { return nodes[node + 1]; }
+  index_type alternativeBegin (index_type clause) const
+    { return clauses[clause]; }
+  index_type alternativeEnd (index_type clause) const
+    { return clauses[clause + 1]; }
+  /* The id of the package an alternative names, or npos if there is no
+     such package. */
+  PackageCollection::id_type target (index_type alternative) const
+    { return targets[alternative]; }
+  /* The package itself; NULL if there is none (any longer). */
+  packagemeta *package (index_type alternative) const
+  {
+    PackageCollection::id_type id = targets[alternative];
+    return id == PackageCollection::npos ? NULL : (*packages)[id];
+  }
+  PackageSpecification *spec (index_type alternative) const
+    { return specs[alternative]; }
+private:
+  PackageCollection *packages;
+  unsigned int generation_;
+  /* the first clause of each node, and one past the last one */
+  std::vector<index_type> nodes;
+  /* the first alternative of each clause, and one past the last one */
+  std::vector<index_type> clauses;
+  std::vector<PackageCollection::id_type> targets;
+  std::vector<PackageSpecification *> specs;
+};
+
+#endif /* SETUP_DEPENDENCYGRAPH_H */
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#include "DependentIndex.h"
+
+#include "package_meta.h"
+
+DependentIndex::DependentIndex (PackageCollection &aCollection,
+				DependencyGraph &aGraph,
+				ProviderIndex &someProviders) :
+  packages (&aCollection), graph (&aGraph), providers (&someProviders),
+  built (false)
+{
+}
+
+void
+DependentIndex::build ()
+{
+  PackageCollection::id_type ids = packages->ids ();
+  /* Every dependency once, as the package depended on and the dependent,
+     then sorted into place by counting. */
+  std::vector<std::pair<PackageCollection::id_type, Dependent> > edges;
+  /* the last version that depended on each package, to add it once */
+  std::vector<uint32_t> lastVersion (ids, (uint32_t) -1);
+  uint32_t version = 0;
+  for (PackageCollection::id_type id = 0; id < ids; ++id)
+    {
+      packagemeta *pkg = (*packages)[id];
+      if (!pkg)
+	continue;
+      for (std::set<packageversion>::iterator v = pkg->versions.begin ();
+	   v != pkg->versions.end (); ++v, ++version)
+	{
+	  Dependent dependent = { id, *v };
+	  DependencyGraph::index_type node
+	    = const_cast<packageversion &> (*v).dependencyNode ();
+	  for (DependencyGraph::index_type c = graph->clauseBegin (node);
+	       c != graph->clauseEnd (node); ++c)
+	    for (DependencyGraph::index_type a = graph->alternativeBegin (c);
+		 a != graph->alternativeEnd (c); ++a)
+	      {
+		PackageCollection::id_type target = graph->target (a);
+		if (target != PackageCollection::npos && target != id
+		    && lastVersion[target] != version)
+		  {
+		    lastVersion[target] = version;
+		    edges.push_back (std::make_pair (target, dependent));
+		  }
+		ProviderIndex::range r = providers->find (*graph->spec (a));
+		for (ProviderIndex::const_iterator p = r.first; p != r.second;
+		     ++p)
+		  if (p->id != id && lastVersion[p->id] != version
+		      && graph->spec (a)->satisfiedBy (*p->provided))
+		    {
+		      lastVersion[p->id] = version;
+		      edges.push_back (std::make_pair (p->id, dependent));
+		    }
+	      }
+	}
+    }
+
+  starts.assign (ids + 1, 0);
+  for (size_t e = 0; e < edges.size (); ++e)
+    ++starts[edges[e].first + 1];
+  for (PackageCollection::id_type id = 0; id < ids; ++id)
+    starts[id + 1] += starts[id];
+  std::vector<uint32_t> next (starts.begin (), starts.end () - 1);
+  dependents.resize (edges.size ());
+  /* the edges are in dependent id order, and stay so */
+  for (size_t e = 0; e < edges.size (); ++e)
+    dependents[next[edges[e].first]++] = edges[e].second;
+  built = true;
+}
+
+void
+DependentIndex::clear ()
+{
+  starts.clear ();
+  dependents.clear ();
+  built = false;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#ifndef SETUP_DEPENDENTINDEX_H
+#define SETUP_DEPENDENTINDEX_H
+
+/* The reverse of the depends lists: for every package, the package
+ * versions that depend on it, so that "who needs this?" doesn't mean
+ * walking the depends of every version there is.
+ *
+ * A version depends on a package if an alternative of one of its clauses
+ * names the package, or a name one of the package's versions provides.
+ * The dependents of all packages are kept in one vector, those of each
+ * package together and in package id order, a version at most once.
+ *
+ * Like ProviderIndex, the index is built the first time it is asked for
+ * and again by build (); it does not notice packages or versions added
+ * later by itself.  packagedb::link () clears it with the graph, so it is
+ * built again after each time the setup.ini files are read.
+ */
+
+#include <utility>
+#include <vector>
+#include "DependencyGraph.h"
+#include "PackageCollection.h"
+#include "ProviderIndex.h"
+#include "package_version.h"
+
+class DependentIndex
+{
+public:
+  struct Dependent
+  {
+    PackageCollection::id_type id;
+    packageversion version;
+  };
+  typedef std::vector<Dependent>::const_iterator const_iterator;
+  typedef std::pair<const_iterator, const_iterator> range;
+
+  DependentIndex (PackageCollection &packages, DependencyGraph &graph,
+		  ProviderIndex &providers);
+
+  /* Index the versions of the packages as they are now. */
+  void build ();
+  /* Forget everything; the next find () builds the index again. */
+  void clear ();
+
+  /* The versions depending on the package id. */
+  range find (PackageCollection::id_type id)
+  {
+    if (!built)
+      build ();
+    if (id + 1 >= starts.size ())
+      return range (dependents.end (), dependents.end ());
+    return range (dependents.begin () + starts[id],
+		  dependents.begin () + starts[id + 1]);
+  }
+private:
+  PackageCollection *packages;
+  DependencyGraph *graph;
+  ProviderIndex *providers;
+  /* where the dependents of each package start, and one past the last */
+  std::vector<uint32_t> starts;
+  std::vector<Dependent> dependents;
+  bool built;
+};
+
+#endif /* SETUP_DEPENDENTINDEX_H */
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#include "DescriptionText.h"
+#include "package_db.h"
+#include <string.h>
+
+bool DescriptionText::lazy = false;
+
+/* Only the main thread builds the package database. */
+DescriptionText::DescriptionText (const std::string& aText) :
+  text (0), length (aText.size ())
+{
+  if (length)
+    {
+      char *p = (char *) packagedb::descriptions.allocate (length, 1);
+      memcpy (p, aText.data (), length);
+      text = p;
+    }
+}
+
+bool
+DescriptionText::same (const char *aText, size_t aLength) const
+{
+  return aLength == length && (!length || !memcmp (aText, text, length));
+}
+
+const unsigned char *
+DescriptionText::retain (std::vector<unsigned char> &buffer)
+{
+  packagedb::descriptionSources.push_back (std::vector<unsigned char> ());
+  packagedb::descriptionSources.back ().swap (buffer);
+  return packagedb::descriptionSources.back ().data ();
+}
+
+size_t
+DescriptionText::retained ()
+{
+  size_t bytes = packagedb::descriptions.size ();
+  for (std::list<std::vector<unsigned char> >::const_iterator i
+	 = packagedb::descriptionSources.begin ();
+       i != packagedb::descriptionSources.end (); ++i)
+    bytes += i->size ();
+  return bytes;
+}
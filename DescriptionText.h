@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#ifndef SETUP_DESCRIPTIONTEXT_H
+#define SETUP_DESCRIPTIONTEXT_H
+
+/* A package description, kept in an immutable buffer of the package
+ * database.
+ *
+ * Only a handful of the thousands of sdesc and ldesc texts in setup.ini
+ * are ever displayed.  Rather than a std::string of its own in every
+ * package version, each is a pointer and a length, and only turned back
+ * into a std::string by str () - that is, when SDesc () or LDesc () is
+ * called.  By default the text is copied into packagedb::descriptions,
+ * packed together with all the others.  In lazy mode, what is loaded from
+ * the package database snapshot is not copied at all: the snapshot is kept
+ * in packagedb::descriptionSources instead and the text referred to where
+ * it is.  That saves copying, but keeps every other field of the snapshot
+ * too.  Either way the text is freed by packagedb::clear ().
+ */
+
+#include <string>
+#include <vector>
+
+class DescriptionText
+{
+public:
+  DescriptionText () : text (0), length (0) {}
+  /* Adds a copy of aText to packagedb::descriptions. */
+  explicit DescriptionText (const std::string& aText);
+  /* Refers to the aLength bytes at aText, which must be in a buffer kept
+     by retain (). */
+  DescriptionText (const char *aText, size_t aLength) :
+    text (aLength ? aText : 0), length (aLength) {}
+
+  std::string str () const
+    { return length ? std::string (text, length) : std::string (); }
+  bool empty () const { return !length; }
+  size_t size () const { return length; }
+  bool same (const char *aText, size_t aLength) const;
+  bool same (const std::string& aText) const
+    { return same (aText.data (), aText.size ()); }
+
+  /* Whether descriptions are referred to rather than copied, where the
+     caller can retain () what they are in. */
+  static bool lazy;
+  /* Keep the contents of buffer, which is left empty, until
+     packagedb::clear (); returns where they are now. */
+  static const unsigned char *retain (std::vector<unsigned char> &buffer);
+  /* Bytes held for all descriptions so far. */
+  static size_t retained ();
+private:
+  const char *text;
+  unsigned int length;
+};
+
+#endif /* SETUP_DESCRIPTIONTEXT_H */
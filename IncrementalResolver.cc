@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#include "IncrementalResolver.h"
+
+#include <algorithm>
+#include "package_db.h"
+#include "package_meta.h"
+#include "SatResolver.h"
+
+IncrementalResolver::~IncrementalResolver ()
+{
+  delete sat;
+}
+
+std::vector<packagemeta *> const &
+IncrementalResolver::resolve (trusts deftrust)
+{
+  delta.swap (changes);
+  changes.clear ();
+  touched_ = 0;
+  if (delta.empty ())
+    return delta;
+
+  packagedb db;
+  db.markUnVisited ();
+  /* the packages either selects are added after these; as on a change of
+     trust, the depends are followed if the selections can't all be met */
+  if (satSolver && sat && sat->defaultTrust () != deftrust)
+    {
+      delete sat;
+      sat = NULL;
+    }
+  if (satSolver && !sat)
+    sat = new SatResolver (deftrust);
+  if (satSolver && sat->resolve (&delta))
+    touched_ = db.packages.size ();
+  else
+    {
+      size_t changedByUser = delta.size ();
+      packageversion::recordSelectionChanges (&delta);
+      for (size_t i = 0; i < changedByUser; ++i)
+	delta[i]->set_requirements (deftrust, touched_);
+      packageversion::recordSelectionChanges (NULL);
+    }
+
+  std::sort (delta.begin (), delta.end ());
+  delta.erase (std::unique (delta.begin (), delta.end ()), delta.end ());
+  return delta;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#ifndef SETUP_INCREMENTALRESOLVER_H
+#define SETUP_INCREMENTALRESOLVER_H
+
+/* Meets the requirements of the selections that changed, instead of those
+ * of every package: the chooser calls changed () for each package whose
+ * selection the user changes, and resolve () once the click is handled.
+ * resolve () follows the depends of the changed packages the way
+ * packagemeta::set_requirements () does, so it takes as long as the part of
+ * the dependency closure they reach takes, however many packages there
+ * are.
+ *
+ * The packages depending on a changed one are left alone: going through
+ * them would select again what the user has just deselected.  What that
+ * leaves unmet PrereqChecker reports, as it always has.
+ *
+ * resolve () returns the delta, the packages whose selection changed,
+ * so the chooser need only redraw those.
+ *
+ * With useSatSolver (), which the chooser sets for --sat-solver, resolve ()
+ * solves all the selections again with a SatResolver instead, as a change
+ * of trust does; that honours conflicts, replaces and provides.  The
+ * SatResolver, and so the encoding of the package database, is kept from
+ * one click to the next, and only made again when the trust changes.  A
+ * click still solves for every package, but no longer encodes them all.
+ */
+
+#include <vector>
+#include "PackageTrust.h"
+
+class packagemeta;
+class SatResolver;
+
+class IncrementalResolver
+{
+public:
+  IncrementalResolver () : touched_ (0), satSolver (false), sat (NULL) {}
+  ~IncrementalResolver ();
+
+  /* The selection of pkg was changed, other than by resolve (). */
+  void changed (packagemeta *pkg) { changes.push_back (pkg); }
+  /* Meet the requirements of the packages changed () since the last time,
+     and forget them.  Returns them and the packages this selected or
+     changed the selection of, each once, until the next resolve (). */
+  std::vector<packagemeta *> const &resolve (trusts deftrust);
+  /* the packages the last resolve () looked at */
+  size_t touched () const { return touched_; }
+  /* Resolve all the selections as a whole from now on, or not. */
+  void useSatSolver (bool useSat) { satSolver = useSat; }
+private:
+  /* not copied */
+  IncrementalResolver (IncrementalResolver const &);
+  IncrementalResolver &operator = (IncrementalResolver const &);
+
+  std::vector<packagemeta *> changes;
+  std::vector<packagemeta *> delta;
+  size_t touched_;
+  bool satSolver;
+  /* kept for the next click */
+  SatResolver *sat;
+};
+
+#endif /* SETUP_INCREMENTALRESOLVER_H */
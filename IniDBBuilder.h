@@ -17,6 +17,7 @@
 #define SETUP_INIDBBUILDER_H
 
 #include "PackageSpecification.h"
+#include "DescriptionText.h"
 
 class IniDBBuilder
 {
@@ -28,6 +29,11 @@ public:
   virtual void buildPackageVersion (const std::string& ) = 0;
   virtual void buildPackageSDesc (const std::string& ) = 0;
   virtual void buildPackageLDesc (const std::string& ) = 0;
+  /* The same, with text that needn't be copied; see DescriptionText.h. */
+  virtual void buildPackageSDescText (DescriptionText const &d)
+    { buildPackageSDesc (d.str ()); }
+  virtual void buildPackageLDescText (DescriptionText const &d)
+    { buildPackageLDesc (d.str ()); }
   virtual void buildPackageInstall (const std::string& ) = 0;
   virtual void buildPackageSource (const std::string&, const std::string&) = 0;
   virtual void buildSourceFile (unsigned char const[16],
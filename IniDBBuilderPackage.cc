@@ -87,7 +87,7 @@ IniDBBuilderPackage::buildPackage (const std::string& name)
   if (!cp)
     {
       cp = new packagemeta (name);
-      db.packages.insert (packagedb::packagecollection::value_type(cp->name,cp));
+      db.packages.insert (cp);
     }
   cbpv = cygpackage::createInstance (name, package_binary);
   cspv = packageversion ();
@@ -122,6 +122,18 @@ IniDBBuilderPackage::buildPackageLDesc (const std::string& theDesc)
 #endif
 }
 
+void
+IniDBBuilderPackage::buildPackageSDescText (DescriptionText const &theDesc)
+{
+  cbpv.set_sdesc (theDesc);
+}
+
+void
+IniDBBuilderPackage::buildPackageLDescText (DescriptionText const &theDesc)
+{
+  cbpv.set_ldesc (theDesc);
+}
+
 void
 IniDBBuilderPackage::buildPackageInstall (const std::string& path)
 {
@@ -140,29 +152,28 @@ IniDBBuilderPackage::buildPackageSource (const std::string& path,
       /* Copy the existing meta data to a new source package */
       csp = new packagemeta (*cp);
       /* delete versions information */
-      csp->versions.clear();
+      csp->clearVersions ();
       csp->desired = packageversion();
       csp->installed = packageversion();
       csp->prev = packageversion();
       csp->curr = packageversion();
       csp->exp = packageversion();
-      db.sourcePackages.insert (packagedb::packagecollection::value_type(csp->name,csp));
+      db.sourcePackages.insert (csp);
     }
   /* create a source packageversion */
   cspv = cygpackage::createInstance (cbpv.Name(), package_source);
   cspv.setCanonicalVersion (cbpv.Canonical_version());
-  set<packageversion>::iterator i=find (csp->versions.begin(),
-    csp->versions.end(), cspv);
-  if (i == csp->versions.end())
+  packageversion existing = csp->findVersion (cspv.Canonical_version ());
+  if (!existing)
     {
       csp->add_version (cspv);
     }
   else
-    cspv = *i;
+    cspv = existing;
 
   if (!cspv.source()->Canonical())
     cspv.source()->set_canonical (path.c_str());
-  cspv.source()->sites.push_back(site(parse_mirror));
+  cspv.source()->add_site (parse_mirror);
 
   /* creates the relationship between binary and source packageversions */
   cbpv.setSourcePackageSpecification (PackageSpecification (cspv.Name()));
@@ -445,14 +456,15 @@ IniDBBuilderPackage::buildPackageListAndNode ()
     	{
      	  ostream &os = Log (LOG_BABBLE);
      	  os << "Current OR list is :";
-     	  for (vector<PackageSpecification *>::const_iterator i= currentOrList->begin();
+     	  for (PackageOrList::const_iterator i= currentOrList->begin();
      	       i != currentOrList->end(); ++i)
      	      os << endl << **i;
      	  os << endLog;
     	}
 #endif
       currentSpec = NULL;
-      currentOrList = new vector<PackageSpecification *>;
+      currentOrList = packagedb::dependencies.create<PackageOrList>
+	(ArenaAllocator<PackageSpecification *> (packagedb::dependencies));
       currentAndList->push_back (currentOrList);
     }
   else
@@ -466,7 +478,8 @@ IniDBBuilderPackage::buildPackageListOrNode (const std::string& packageName)
 {
   if (currentOrList)
     {
-      currentSpec = new PackageSpecification (packageName);
+      currentSpec =
+	packagedb::dependencies.create<PackageSpecification> (packageName);
       currentOrList->push_back (currentSpec);
 #if DEBUG
       Log (LOG_BABBLE) << "New OR node in a package list refers to \"" <<
@@ -519,43 +532,38 @@ IniDBBuilderPackage::buildPackageListOperatorVersion (const std::string& aVersio
 void
 IniDBBuilderPackage::add_correct_version()
 {
-  int merged = 0;
-  for (set<packageversion>::iterator n = cp->versions.begin();
-       !merged && n != cp->versions.end(); ++n)
-    if (*n == cbpv )
-      {
-	packageversion ver = *n;
-        /* ASSUMPTIONS:
-           categories and requires are consistent for the same version across
-           all mirrors
-           */
-        /*
-          XXX: if the versions are equal but the size/md5sum are different,
-          we should alert the user, as they may not be getting what they expect...
-        */
-        /* Copy the binary mirror across if this site claims to have an install */
-        if (cbpv.source()->sites.size() )
-          ver.source()->sites.push_back(site (cbpv.source()->sites.begin()->key));
-        /* Copy the descriptions across */
-        if (cbpv.SDesc ().size() && !n->SDesc ().size())
-          ver.set_sdesc (cbpv.SDesc ());
-        if (cbpv.LDesc ().size() && !n->LDesc ().size())
-          ver.set_ldesc (cbpv.LDesc ());
-	if (cbpv.depends()->size() && !ver.depends ()->size())
-	  *ver.depends() = *cbpv.depends();
-	/* TODO: other package lists */
-	/* Prevent dangling references */
-	currentOrList = NULL;
-	currentAndList = NULL;
-	currentSpec = NULL;
-        cbpv = *n;
-        merged = 1;
+  packageversion ver = cp->findVersion (cbpv.Canonical_version ());
+  if (ver)
+    {
+      /* ASSUMPTIONS:
+	 categories and requires are consistent for the same version across
+	 all mirrors
+	 */
+      /*
+	XXX: if the versions are equal but the size/md5sum are different,
+	we should alert the user, as they may not be getting what they expect...
+      */
+      /* Copy the binary mirror across if this site claims to have an install */
+      if (cbpv.source()->sites.size() )
+	ver.source()->add_site (cbpv.source()->sites.begin()->key);
+      /* Copy the descriptions across */
+      if (cbpv.SDesc ().size() && !ver.SDesc ().size())
+	ver.set_sdesc (cbpv.SDesc ());
+      if (cbpv.LDesc ().size() && !ver.LDesc ().size())
+	ver.set_ldesc (cbpv.LDesc ());
+      if (cbpv.depends()->size() && !ver.depends ()->size())
+	*ver.depends() = *cbpv.depends();
+      /* TODO: other package lists */
+      /* Prevent dangling references */
+      currentOrList = NULL;
+      currentAndList = NULL;
+      currentSpec = NULL;
+      cbpv = ver;
 #if DEBUG
-        Log (LOG_BABBLE) << cp->name << " merged with an existing version " << cbpv.Canonical_version() << endLog;
+      Log (LOG_BABBLE) << cp->name << " merged with an existing version " << cbpv.Canonical_version() << endLog;
 #endif
-      }
-
-  if (!merged)
+    }
+  else
     {
       cp->add_version (cbpv);
 #if DEBUG
@@ -601,7 +609,7 @@ IniDBBuilderPackage::process_src (packagesource &src, const std::string& path)
 {
   if (!src.Canonical())
     src.set_canonical (path.c_str());
-  src.sites.push_back(site(parse_mirror));
+  src.add_site (parse_mirror);
 
   if (!cbpv.Canonical_version ().size())
     {
@@ -34,6 +34,8 @@ public:
   virtual void buildPackageVersion (const std::string& );
   virtual void buildPackageSDesc (const std::string& );
   virtual void buildPackageLDesc (const std::string& );
+  virtual void buildPackageSDescText (DescriptionText const &);
+  virtual void buildPackageLDescText (DescriptionText const &);
   virtual void buildPackageInstall (const std::string& );
   virtual void buildPackageSource (const std::string&, const std::string&);
   virtual void buildSourceFile (unsigned char const[16],
@@ -78,8 +80,8 @@ private:
   packagemeta *csp;
   packageversion cspv;
   PackageSpecification *currentSpec;
-  std::vector<PackageSpecification *> *currentOrList;
-  std::vector<std::vector<PackageSpecification *> *> *currentAndList;
+  PackageOrList *currentOrList;
+  PackageAndList *currentAndList;
   int trust;
   IniParseFeedback const &_feedback;
 };
@@ -0,0 +1,1037 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#include "IniDBSnapshot.h"
+
+#include <string.h>
+#include <map>
+#include <vector>
+
+#include "io_stream.h"
+#include "setup_version.h"
+#include "LogSingleton.h"
+
+/* Bump this whenever the record stream or the builder semantics change. */
+#define SNAPSHOT_MAGIC "SETUPSNP"
+#define SNAPSHOT_FORMAT 2
+
+/* magic, format, payload length, key */
+#define SNAPSHOT_HEADER_SIZE (8 + 4 + 4 + SHA512_DIGEST_LENGTH)
+
+enum snapshot_op
+{
+  SNAP_BEGIN_INI = 1,
+  SNAP_END_INI,
+  SNAP_TIMESTAMP,
+  SNAP_VERSION,
+  SNAP_PACKAGE,
+  SNAP_PACKAGE_VERSION,
+  SNAP_SDESC,
+  SNAP_LDESC,
+  SNAP_INSTALL,
+  SNAP_SOURCE,
+  SNAP_SOURCE_FILE,
+  SNAP_TRUST,
+  SNAP_CATEGORY,
+  SNAP_DEPENDS,
+  SNAP_PREDEPENDS,
+  SNAP_PRIORITY,
+  SNAP_INSTALLED_SIZE,
+  SNAP_MAINTAINER,
+  SNAP_ARCHITECTURE,
+  SNAP_INSTALL_SIZE,
+  SNAP_INSTALL_SHA512,
+  SNAP_SOURCE_SHA512,
+  SNAP_INSTALL_MD5,
+  SNAP_SOURCE_MD5,
+  SNAP_RECOMMENDS,
+  SNAP_SUGGESTS,
+  SNAP_REPLACES,
+  SNAP_CONFLICTS,
+  SNAP_PROVIDES,
+  SNAP_BUILDDEPENDS,
+  SNAP_BINARY,
+  SNAP_DESCRIPTION,
+  SNAP_SOURCE_NAME,
+  SNAP_SOURCE_NAME_VERSION,
+  SNAP_AND_NODE,
+  SNAP_OR_NODE,
+  SNAP_OPERATOR,
+  SNAP_OPERATOR_VERSION,
+  SNAP_MESSAGE
+};
+
+static PackageSpecification::_operators const *const snapshot_operators[] =
+{
+  &PackageSpecification::Equals,
+  &PackageSpecification::LessThan,
+  &PackageSpecification::MoreThan,
+  &PackageSpecification::LessThanEquals,
+  &PackageSpecification::MoreThanEquals
+};
+#define NOPERATORS (sizeof (snapshot_operators) / sizeof (*snapshot_operators))
+
+static void
+put_u32 (unsigned char *p, unsigned int v)
+{
+  p[0] = v & 0xff;
+  p[1] = (v >> 8) & 0xff;
+  p[2] = (v >> 16) & 0xff;
+  p[3] = (v >> 24) & 0xff;
+}
+
+static unsigned int
+get_u32 (unsigned char const *p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24);
+}
+
+/* the recorder */
+
+IniDBSnapshotRecorder::IniDBSnapshotRecorder (IniDBBuilder &aBuilder) :
+  _builder (&aBuilder), _data ()
+{
+  timestamp = 0;
+}
+
+IniDBSnapshotRecorder::IniDBSnapshotRecorder () :
+  _builder (NULL), _data ()
+{
+  timestamp = 0;
+}
+
+IniDBSnapshotRecorder::~IniDBSnapshotRecorder ()
+{
+}
+
+void
+IniDBSnapshotRecorder::op (unsigned char anOp)
+{
+  _data += (char) anOp;
+}
+
+void
+IniDBSnapshotRecorder::str (const std::string& s)
+{
+  unsigned char len[4];
+  put_u32 (len, s.size ());
+  _data.append ((char const *) len, 4);
+  _data += s;
+}
+
+void
+IniDBSnapshotRecorder::bytes (unsigned char const *b, size_t len)
+{
+  _data.append ((char const *) b, len);
+}
+
+void
+IniDBSnapshotRecorder::beginIni (const std::string& mirror)
+{
+  op (SNAP_BEGIN_INI);
+  str (mirror);
+  parse_mirror = mirror;
+  if (_builder)
+    _builder->parse_mirror = mirror;
+}
+
+void
+IniDBSnapshotRecorder::endIni (unsigned char const digest[SHA512_DIGEST_LENGTH])
+{
+  op (SNAP_END_INI);
+  bytes (digest, SHA512_DIGEST_LENGTH);
+}
+
+void
+IniDBSnapshotRecorder::append (IniDBSnapshotRecorder const &other)
+{
+  _data += other._data;
+}
+
+void
+IniDBSnapshotRecorder::buildTimestamp (const std::string& s)
+{
+  op (SNAP_TIMESTAMP);
+  str (s);
+  if (_builder)
+    {
+      _builder->buildTimestamp (s);
+      timestamp = _builder->timestamp;
+    }
+}
+
+void
+IniDBSnapshotRecorder::buildVersion (const std::string& s)
+{
+  op (SNAP_VERSION);
+  str (s);
+  if (_builder)
+    {
+      _builder->buildVersion (s);
+      version = _builder->version;
+    }
+}
+
+void
+IniDBSnapshotRecorder::buildPackage (const std::string& s)
+{
+  op (SNAP_PACKAGE);
+  str (s);
+  if (_builder)
+    _builder->buildPackage (s);
+}
+
+void
+IniDBSnapshotRecorder::buildPackageVersion (const std::string& s)
+{
+  op (SNAP_PACKAGE_VERSION);
+  str (s);
+  if (_builder)
+    _builder->buildPackageVersion (s);
+}
+
+void
+IniDBSnapshotRecorder::buildPackageSDesc (const std::string& s)
+{
+  op (SNAP_SDESC);
+  str (s);
+  if (_builder)
+    _builder->buildPackageSDesc (s);
+}
+
+void
+IniDBSnapshotRecorder::buildPackageLDesc (const std::string& s)
+{
+  op (SNAP_LDESC);
+  str (s);
+  if (_builder)
+    _builder->buildPackageLDesc (s);
+}
+
+void
+IniDBSnapshotRecorder::buildPackageInstall (const std::string& s)
+{
+  op (SNAP_INSTALL);
+  str (s);
+  if (_builder)
+    _builder->buildPackageInstall (s);
+}
+
+void
+IniDBSnapshotRecorder::buildPackageSource (const std::string& path,
+					   const std::string& size)
+{
+  op (SNAP_SOURCE);
+  str (path);
+  str (size);
+  if (_builder)
+    _builder->buildPackageSource (path, size);
+}
+
+void
+IniDBSnapshotRecorder::buildSourceFile (unsigned char const *md5,
+					const std::string& size,
+					const std::string& path)
+{
+  op (SNAP_SOURCE_FILE);
+  bytes (md5, 16);
+  str (size);
+  str (path);
+  if (_builder)
+    _builder->buildSourceFile (md5, size, path);
+}
+
+void
+IniDBSnapshotRecorder::buildPackageTrust (int trust)
+{
+  unsigned char t[4];
+  put_u32 (t, trust);
+  op (SNAP_TRUST);
+  bytes (t, 4);
+  if (_builder)
+    _builder->buildPackageTrust (trust);
+}
+
+void
+IniDBSnapshotRecorder::buildPackageCategory (const std::string& s)
+{
+  op (SNAP_CATEGORY);
+  str (s);
+  if (_builder)
+    _builder->buildPackageCategory (s);
+}
+
+void
+IniDBSnapshotRecorder::buildBeginDepends ()
+{
+  op (SNAP_DEPENDS);
+  if (_builder)
+    _builder->buildBeginDepends ();
+}
+
+void
+IniDBSnapshotRecorder::buildBeginPreDepends ()
+{
+  op (SNAP_PREDEPENDS);
+  if (_builder)
+    _builder->buildBeginPreDepends ();
+}
+
+void
+IniDBSnapshotRecorder::buildPriority (const std::string& s)
+{
+  op (SNAP_PRIORITY);
+  str (s);
+  if (_builder)
+    _builder->buildPriority (s);
+}
+
+void
+IniDBSnapshotRecorder::buildInstalledSize (const std::string& s)
+{
+  op (SNAP_INSTALLED_SIZE);
+  str (s);
+  if (_builder)
+    _builder->buildInstalledSize (s);
+}
+
+void
+IniDBSnapshotRecorder::buildMaintainer (const std::string& s)
+{
+  op (SNAP_MAINTAINER);
+  str (s);
+  if (_builder)
+    _builder->buildMaintainer (s);
+}
+
+void
+IniDBSnapshotRecorder::buildArchitecture (const std::string& s)
+{
+  op (SNAP_ARCHITECTURE);
+  str (s);
+  if (_builder)
+    _builder->buildArchitecture (s);
+}
+
+void
+IniDBSnapshotRecorder::buildInstallSize (const std::string& s)
+{
+  op (SNAP_INSTALL_SIZE);
+  str (s);
+  if (_builder)
+    _builder->buildInstallSize (s);
+}
+
+void
+IniDBSnapshotRecorder::buildInstallSHA512 (unsigned char const *sha512)
+{
+  op (SNAP_INSTALL_SHA512);
+  bytes (sha512, SHA512_DIGEST_LENGTH);
+  if (_builder)
+    _builder->buildInstallSHA512 (sha512);
+}
+
+void
+IniDBSnapshotRecorder::buildSourceSHA512 (unsigned char const *sha512)
+{
+  op (SNAP_SOURCE_SHA512);
+  bytes (sha512, SHA512_DIGEST_LENGTH);
+  if (_builder)
+    _builder->buildSourceSHA512 (sha512);
+}
+
+void
+IniDBSnapshotRecorder::buildInstallMD5 (unsigned char const *md5)
+{
+  op (SNAP_INSTALL_MD5);
+  bytes (md5, 16);
+  if (_builder)
+    _builder->buildInstallMD5 (md5);
+}
+
+void
+IniDBSnapshotRecorder::buildSourceMD5 (unsigned char const *md5)
+{
+  op (SNAP_SOURCE_MD5);
+  bytes (md5, 16);
+  if (_builder)
+    _builder->buildSourceMD5 (md5);
+}
+
+void
+IniDBSnapshotRecorder::buildBeginRecommends ()
+{
+  op (SNAP_RECOMMENDS);
+  if (_builder)
+    _builder->buildBeginRecommends ();
+}
+
+void
+IniDBSnapshotRecorder::buildBeginSuggests ()
+{
+  op (SNAP_SUGGESTS);
+  if (_builder)
+    _builder->buildBeginSuggests ();
+}
+
+void
+IniDBSnapshotRecorder::buildBeginReplaces ()
+{
+  op (SNAP_REPLACES);
+  if (_builder)
+    _builder->buildBeginReplaces ();
+}
+
+void
+IniDBSnapshotRecorder::buildBeginConflicts ()
+{
+  op (SNAP_CONFLICTS);
+  if (_builder)
+    _builder->buildBeginConflicts ();
+}
+
+void
+IniDBSnapshotRecorder::buildBeginProvides ()
+{
+  op (SNAP_PROVIDES);
+  if (_builder)
+    _builder->buildBeginProvides ();
+}
+
+void
+IniDBSnapshotRecorder::buildBeginBuildDepends ()
+{
+  op (SNAP_BUILDDEPENDS);
+  if (_builder)
+    _builder->buildBeginBuildDepends ();
+}
+
+void
+IniDBSnapshotRecorder::buildBeginBinary ()
+{
+  op (SNAP_BINARY);
+  if (_builder)
+    _builder->buildBeginBinary ();
+}
+
+void
+IniDBSnapshotRecorder::buildDescription (const std::string& s)
+{
+  op (SNAP_DESCRIPTION);
+  str (s);
+  if (_builder)
+    _builder->buildDescription (s);
+}
+
+void
+IniDBSnapshotRecorder::buildSourceName (const std::string& s)
+{
+  op (SNAP_SOURCE_NAME);
+  str (s);
+  if (_builder)
+    _builder->buildSourceName (s);
+}
+
+void
+IniDBSnapshotRecorder::buildSourceNameVersion (const std::string& s)
+{
+  op (SNAP_SOURCE_NAME_VERSION);
+  str (s);
+  if (_builder)
+    _builder->buildSourceNameVersion (s);
+}
+
+void
+IniDBSnapshotRecorder::buildPackageListAndNode ()
+{
+  op (SNAP_AND_NODE);
+  if (_builder)
+    _builder->buildPackageListAndNode ();
+}
+
+void
+IniDBSnapshotRecorder::buildPackageListOrNode (const std::string& s)
+{
+  op (SNAP_OR_NODE);
+  str (s);
+  if (_builder)
+    _builder->buildPackageListOrNode (s);
+}
+
+void
+IniDBSnapshotRecorder::buildPackageListOperator (PackageSpecification::_operators const &anOperator)
+{
+  unsigned char n;
+  for (n = 0; n < NOPERATORS; ++n)
+    if (*snapshot_operators[n] == anOperator)
+      break;
+  op (SNAP_OPERATOR);
+  bytes (&n, 1);
+  if (_builder)
+    _builder->buildPackageListOperator (anOperator);
+}
+
+void
+IniDBSnapshotRecorder::buildPackageListOperatorVersion (const std::string& s)
+{
+  op (SNAP_OPERATOR_VERSION);
+  str (s);
+  if (_builder)
+    _builder->buildPackageListOperatorVersion (s);
+}
+
+void
+IniDBSnapshotRecorder::buildMessage (const std::string& id,
+				     const std::string& message)
+{
+  op (SNAP_MESSAGE);
+  str (id);
+  str (message);
+  if (_builder)
+    _builder->buildMessage (id, message);
+}
+
+/* the key */
+
+IniDBSnapshot::IniDBSnapshot ()
+{
+  SHA512Init (&ctx);
+  /* A different setup binary may build a different database from the same
+     setup files, so never reuse a snapshot across setup versions. */
+  std::string salt = std::string (SNAPSHOT_MAGIC " " TOSTRING (SNAPSHOT_FORMAT)
+				  " ") + setup_version;
+  SHA512Update (&ctx, (unsigned char const *) salt.c_str (), salt.size () + 1);
+}
+
+void
+IniDBSnapshot::addIni (const std::string& mirror, io_stream *ini)
+{
+  SHA512Update (&ctx, (unsigned char const *) mirror.c_str (),
+		mirror.size () + 1);
+  unsigned char buffer[64 * 1024];
+  ssize_t count;
+  ini->seek (0, IO_SEEK_SET);
+  while ((count = ini->read (buffer, sizeof (buffer))) > 0)
+    SHA512Update (&ctx, buffer, count);
+  ini->seek (0, IO_SEEK_SET);
+}
+
+void
+IniDBSnapshot::digest (unsigned char result[SHA512_DIGEST_LENGTH])
+{
+  SHA512Final (result, &ctx);
+}
+
+/* replay */
+
+class SnapshotReader
+{
+public:
+  SnapshotReader (unsigned char const *data, size_t len) :
+    ok (true), pos (data), end (data + len) {}
+  bool atEnd () const { return pos >= end; }
+  size_t offset (unsigned char const *start) const { return pos - start; }
+  unsigned char op ()
+  {
+    if (!need (1))
+      return 0;
+    return *pos++;
+  }
+  unsigned int u32 ()
+  {
+    if (!need (4))
+      return 0;
+    unsigned int v = get_u32 (pos);
+    pos += 4;
+    return v;
+  }
+  std::string str ()
+  {
+    size_t len = u32 ();
+    if (!need (len))
+      return std::string ();
+    std::string s ((char const *) pos, len);
+    pos += len;
+    return s;
+  }
+  /* a string, referred to where it is */
+  DescriptionText text ()
+  {
+    size_t len = u32 ();
+    if (!need (len))
+      return DescriptionText ();
+    DescriptionText t ((char const *) pos, len);
+    pos += len;
+    return t;
+  }
+  unsigned char const *bytes (size_t len)
+  {
+    static unsigned char const zero[SHA512_DIGEST_LENGTH] = { 0 };
+    if (!need (len))
+      return zero;
+    unsigned char const *b = pos;
+    pos += len;
+    return b;
+  }
+  bool ok;
+private:
+  bool need (size_t len)
+  {
+    if (ok && (size_t) (end - pos) >= len)
+      return true;
+    ok = false;
+    pos = end;
+    return false;
+  }
+  unsigned char const *pos, *end;
+};
+
+/* Where the records of one setup file are in a stream. */
+struct ini_extent
+{
+  std::string mirror;
+  size_t begin, end;
+  unsigned char digest[SHA512_DIGEST_LENGTH];
+};
+
+/* Walk the record stream, calling into builder if it is not NULL, and
+   noting where each setup file is in extents if that is not NULL.  If
+   retained, the stream was given to DescriptionText::retain (), and the
+   descriptions are passed on as references into it.  Returns the number of
+   complete setup files, or -1 if the stream is malformed. */
+static int
+replay_stream (unsigned char const *data, size_t len, IniDBBuilder *builder,
+	IniDBSnapshot::iniDoneFn done, std::vector<ini_extent> *extents = NULL,
+	bool retained = false)
+{
+  SnapshotReader in (data, len);
+  int inis = 0;
+  ini_extent extent;
+  while (in.ok && !in.atEnd ())
+    {
+      size_t at = in.offset (data);
+      unsigned char anOp = in.op ();
+      std::string a, b;
+      unsigned char const *d;
+      switch (anOp)
+	{
+	case SNAP_BEGIN_INI:
+	  a = in.str ();
+	  if (builder)
+	    builder->parse_mirror = a;
+	  extent.mirror = a;
+	  extent.begin = at;
+	  break;
+	case SNAP_END_INI:
+	  d = in.bytes (SHA512_DIGEST_LENGTH);
+	  if (!in.ok)
+	    break;
+	  ++inis;
+	  if (builder && done)
+	    done (*builder);
+	  if (extents)
+	    {
+	      extent.end = in.offset (data);
+	      memcpy (extent.digest, d, SHA512_DIGEST_LENGTH);
+	      extents->push_back (extent);
+	    }
+	  break;
+	case SNAP_TIMESTAMP:
+	  a = in.str ();
+	  if (builder && in.ok)
+	    builder->buildTimestamp (a);
+	  break;
+	case SNAP_VERSION:
+	  a = in.str ();
+	  if (builder && in.ok)
+	    builder->buildVersion (a);
+	  break;
+	case SNAP_PACKAGE:
+	  a = in.str ();
+	  if (builder && in.ok)
+	    builder->buildPackage (a);
+	  break;
+	case SNAP_PACKAGE_VERSION:
+	  a = in.str ();
+	  if (builder && in.ok)
+	    builder->buildPackageVersion (a);
+	  break;
+	case SNAP_SDESC:
+	  if (retained)
+	    {
+	      DescriptionText text = in.text ();
+	      if (builder && in.ok)
+		builder->buildPackageSDescText (text);
+	      break;
+	    }
+	  a = in.str ();
+	  if (builder && in.ok)
+	    builder->buildPackageSDesc (a);
+	  break;
+	case SNAP_LDESC:
+	  if (retained)
+	    {
+	      DescriptionText text = in.text ();
+	      if (builder && in.ok)
+		builder->buildPackageLDescText (text);
+	      break;
+	    }
+	  a = in.str ();
+	  if (builder && in.ok)
+	    builder->buildPackageLDesc (a);
+	  break;
+	case SNAP_INSTALL:
+	  a = in.str ();
+	  if (builder && in.ok)
+	    builder->buildPackageInstall (a);
+	  break;
+	case SNAP_SOURCE:
+	  a = in.str ();
+	  b = in.str ();
+	  if (builder && in.ok)
+	    builder->buildPackageSource (a, b);
+	  break;
+	case SNAP_SOURCE_FILE:
+	  d = in.bytes (16);
+	  a = in.str ();
+	  b = in.str ();
+	  if (builder && in.ok)
+	    builder->buildSourceFile (d, a, b);
+	  break;
+	case SNAP_TRUST:
+	  {
+	    int trust = in.u32 ();
+	    if (builder && in.ok)
+	      builder->buildPackageTrust (trust);
+	  }
+	  break;
+	case SNAP_CATEGORY:
+	  a = in.str ();
+	  if (builder && in.ok)
+	    builder->buildPackageCategory (a);
+	  break;
+	case SNAP_DEPENDS:
+	  if (builder)
+	    builder->buildBeginDepends ();
+	  break;
+	case SNAP_PREDEPENDS:
+	  if (builder)
+	    builder->buildBeginPreDepends ();
+	  break;
+	case SNAP_PRIORITY:
+	  a = in.str ();
+	  if (builder && in.ok)
+	    builder->buildPriority (a);
+	  break;
+	case SNAP_INSTALLED_SIZE:
+	  a = in.str ();
+	  if (builder && in.ok)
+	    builder->buildInstalledSize (a);
+	  break;
+	case SNAP_MAINTAINER:
+	  a = in.str ();
+	  if (builder && in.ok)
+	    builder->buildMaintainer (a);
+	  break;
+	case SNAP_ARCHITECTURE:
+	  a = in.str ();
+	  if (builder && in.ok)
+	    builder->buildArchitecture (a);
+	  break;
+	case SNAP_INSTALL_SIZE:
+	  a = in.str ();
+	  if (builder && in.ok)
+	    builder->buildInstallSize (a);
+	  break;
+	case SNAP_INSTALL_SHA512:
+	  d = in.bytes (SHA512_DIGEST_LENGTH);
+	  if (builder && in.ok)
+	    builder->buildInstallSHA512 (d);
+	  break;
+	case SNAP_SOURCE_SHA512:
+	  d = in.bytes (SHA512_DIGEST_LENGTH);
+	  if (builder && in.ok)
+	    builder->buildSourceSHA512 (d);
+	  break;
+	case SNAP_INSTALL_MD5:
+	  d = in.bytes (16);
+	  if (builder && in.ok)
+	    builder->buildInstallMD5 (d);
+	  break;
+	case SNAP_SOURCE_MD5:
+	  d = in.bytes (16);
+	  if (builder && in.ok)
+	    builder->buildSourceMD5 (d);
+	  break;
+	case SNAP_RECOMMENDS:
+	  if (builder)
+	    builder->buildBeginRecommends ();
+	  break;
+	case SNAP_SUGGESTS:
+	  if (builder)
+	    builder->buildBeginSuggests ();
+	  break;
+	case SNAP_REPLACES:
+	  if (builder)
+	    builder->buildBeginReplaces ();
+	  break;
+	case SNAP_CONFLICTS:
+	  if (builder)
+	    builder->buildBeginConflicts ();
+	  break;
+	case SNAP_PROVIDES:
+	  if (builder)
+	    builder->buildBeginProvides ();
+	  break;
+	case SNAP_BUILDDEPENDS:
+	  if (builder)
+	    builder->buildBeginBuildDepends ();
+	  break;
+	case SNAP_BINARY:
+	  if (builder)
+	    builder->buildBeginBinary ();
+	  break;
+	case SNAP_DESCRIPTION:
+	  a = in.str ();
+	  if (builder && in.ok)
+	    builder->buildDescription (a);
+	  break;
+	case SNAP_SOURCE_NAME:
+	  a = in.str ();
+	  if (builder && in.ok)
+	    builder->buildSourceName (a);
+	  break;
+	case SNAP_SOURCE_NAME_VERSION:
+	  a = in.str ();
+	  if (builder && in.ok)
+	    builder->buildSourceNameVersion (a);
+	  break;
+	case SNAP_AND_NODE:
+	  if (builder)
+	    builder->buildPackageListAndNode ();
+	  break;
+	case SNAP_OR_NODE:
+	  a = in.str ();
+	  if (builder && in.ok)
+	    builder->buildPackageListOrNode (a);
+	  break;
+	case SNAP_OPERATOR:
+	  {
+	    unsigned char n = *in.bytes (1);
+	    if (n >= NOPERATORS)
+	      in.ok = false;
+	    else if (builder && in.ok)
+	      builder->buildPackageListOperator (*snapshot_operators[n]);
+	  }
+	  break;
+	case SNAP_OPERATOR_VERSION:
+	  a = in.str ();
+	  if (builder && in.ok)
+	    builder->buildPackageListOperatorVersion (a);
+	  break;
+	case SNAP_MESSAGE:
+	  a = in.str ();
+	  b = in.str ();
+	  if (builder && in.ok)
+	    builder->buildMessage (a, b);
+	  break;
+	default:
+	  in.ok = false;
+	  break;
+	}
+    }
+  return in.ok ? inis : -1;
+}
+
+int
+IniDBSnapshot::replay (IniDBSnapshotRecorder const &recorder,
+		       IniDBBuilder &builder, iniDoneFn done)
+{
+  std::string const &data = recorder.data ();
+  if (DescriptionText::lazy)
+    {
+      std::vector<unsigned char> copy (data.begin (), data.end ());
+      return replay_stream (DescriptionText::retain (copy), data.size (),
+			    &builder, done, NULL, true);
+    }
+  return replay_stream ((unsigned char const *) data.data (), data.size (),
+			&builder, done);
+}
+
+/* Read the snapshot at url into buf and check its header; unless digest
+   is NULL, it must also have been made for that key.  Returns where the
+   record stream starts in buf, or 0 if there is no usable snapshot. */
+static size_t
+read_snapshot (const std::string& url, unsigned char const *digest,
+	       std::vector<unsigned char> &buf)
+{
+  io_stream *f = io_stream::open (url, "rb", 0);
+  if (!f)
+    return 0;
+
+  /* Read the whole thing in one go; everything else decodes in place. */
+  size_t len = f->get_size ();
+  buf.resize (len > SNAPSHOT_HEADER_SIZE ? len : 0);
+  ssize_t got = buf.size () ? f->read (&buf[0], len) : 0;
+  delete f;
+  if (!buf.size () || got != (ssize_t) len)
+    return 0;
+
+  unsigned char const *p = &buf[0];
+  if (memcmp (p, SNAPSHOT_MAGIC, 8)
+      || get_u32 (p + 8) != SNAPSHOT_FORMAT
+      || get_u32 (p + 12) != len - SNAPSHOT_HEADER_SIZE
+      || (digest && memcmp (p + 16, digest, SHA512_DIGEST_LENGTH)))
+    {
+      Log (LOG_BABBLE) << "Package database snapshot " << url
+		       << " is stale or invalid, ignoring it" << endLog;
+      return 0;
+    }
+
+  /* Validate the whole stream before anything is built from it, so a
+     damaged file can never leave the database half-built. */
+  if (replay_stream (p + SNAPSHOT_HEADER_SIZE, len - SNAPSHOT_HEADER_SIZE,
+		     NULL, NULL) <= 0)
+    {
+      Log (LOG_BABBLE) << "Package database snapshot " << url
+		       << " is corrupt, ignoring it" << endLog;
+      return 0;
+    }
+  return SNAPSHOT_HEADER_SIZE;
+}
+
+int
+IniDBSnapshot::load (const std::string& url,
+		     unsigned char const digest[SHA512_DIGEST_LENGTH],
+		     IniDBBuilder &builder, iniDoneFn done)
+{
+  std::vector<unsigned char> buf;
+  size_t start = read_snapshot (url, digest, buf);
+  if (!start)
+    return 0;
+  size_t len = buf.size () - start;
+  if (DescriptionText::lazy)
+    return replay_stream (DescriptionText::retain (buf) + start, len,
+			  &builder, done, NULL, true);
+  return replay_stream (&buf[start], len, &builder, done);
+}
+
+/* Records the calls for one setup file, noting where each package starts,
+   so that they can be picked out by name. */
+class IniPackageSplitter : public IniDBSnapshotRecorder
+{
+public:
+  virtual void buildPackage (const std::string& name)
+  {
+    index[name] = starts.size ();
+    starts.push_back (data ().size ());
+    IniDBSnapshotRecorder::buildPackage (name);
+  }
+  /* The calls before the first package. */
+  std::string header () const
+  {
+    return data ().substr (0, starts.size () ? starts[0] : data ().size ());
+  }
+  /* The calls for package name; false if there is no such package. */
+  bool find (const std::string& name, std::string &calls) const
+  {
+    std::map<std::string, size_t>::const_iterator i = index.find (name);
+    if (i == index.end ())
+      return false;
+    size_t end = i->second + 1 < starts.size () ? starts[i->second + 1]
+						: data ().size ();
+    calls.assign (data (), starts[i->second], end - starts[i->second]);
+    return true;
+  }
+private:
+  std::vector<size_t> starts;
+  std::map<std::string, size_t> index;
+};
+
+bool
+IniDBSnapshot::patch (const std::string& url, const std::string& mirror,
+		      unsigned char const base[SHA512_DIGEST_LENGTH],
+		      IniDBSnapshotRecorder const &changes,
+		      std::vector<std::string> const &order,
+		      unsigned char const digest[SHA512_DIGEST_LENGTH],
+		      IniDBSnapshotRecorder &result)
+{
+  std::vector<unsigned char> buf;
+  size_t start = read_snapshot (url, NULL, buf);
+  if (!start)
+    return false;
+  unsigned char const *p = &buf[start];
+  std::vector<ini_extent> extents;
+  replay_stream (p, buf.size () - start, NULL, NULL, &extents);
+  std::vector<ini_extent>::const_iterator e;
+  for (e = extents.begin (); e != extents.end (); ++e)
+    if (e->mirror == mirror
+	&& !memcmp (e->digest, base, SHA512_DIGEST_LENGTH))
+      break;
+  if (e == extents.end ())
+    return false;
+
+  IniPackageSplitter old, changed;
+  replay_stream (p + e->begin, e->end - e->begin, &old, NULL);
+  if (replay_stream ((unsigned char const *) changes._data.data (),
+		     changes._data.size (), &changed, NULL) != 1)
+    return false;
+
+  std::string calls;
+  result._data.clear ();
+  result.beginIni (mirror);
+  result._data += changed.header ();
+  for (std::vector<std::string>::const_iterator n = order.begin ();
+       n != order.end (); ++n)
+    {
+      if (!changed.find (*n, calls) && !old.find (*n, calls))
+	{
+	  result._data.clear ();
+	  return false;
+	}
+      result._data += calls;
+    }
+  result.endIni (digest);
+  return true;
+}
+
+int
+IniDBSnapshot::save (const std::string& url,
+		     unsigned char const digest[SHA512_DIGEST_LENGTH],
+		     IniDBSnapshotRecorder const &recorder)
+{
+  const std::string tmp = url + ".new";
+  io_stream::mkpath_p (PATH_TO_FILE, tmp, 0);
+  io_stream *f = io_stream::open (tmp, "wb", 0);
+  if (!f)
+    return 1;
+
+  unsigned char header[SNAPSHOT_HEADER_SIZE];
+  memcpy (header, SNAPSHOT_MAGIC, 8);
+  put_u32 (header + 8, SNAPSHOT_FORMAT);
+  put_u32 (header + 12, recorder.data ().size ());
+  memcpy (header + 16, digest, SHA512_DIGEST_LENGTH);
+
+  bool ok = f->write (header, sizeof header) == sizeof header
+	    && f->write (recorder.data ().data (), recorder.data ().size ())
+	       == (ssize_t) recorder.data ().size ();
+  delete f;
+
+  io_stream::remove (url);
+  if (!ok || io_stream::move (tmp, url))
+    {
+      io_stream::remove (tmp);
+      return 1;
+    }
+  return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#ifndef SETUP_INIDBSNAPSHOT_H
+#define SETUP_INIDBSNAPSHOT_H
+
+/* A binary snapshot of the package database built from the setup.ini
+ * files of one run.
+ *
+ * Rather than serialising packagemeta and friends directly, the snapshot
+ * records the stream of IniDBBuilder calls the parser made.  Replaying it
+ * through an IniDBBuilderPackage therefore reproduces exactly the same
+ * packagedb::packages, sourcePackages and categories - including the
+ * merging between mirrors and with installed.db - but without lexing or
+ * parsing anything.
+ *
+ * The file is a fixed header followed by a flat, length-prefixed record
+ * stream.  It is read with a single read into one buffer and decoded in
+ * place, and is only used when the digest stored in the header matches the
+ * digest of the (signature-checked) setup files of the current run.
+ */
+
+#include "IniDBBuilder.h"
+#include "sha2.h"
+#include <string>
+#include <vector>
+
+class io_stream;
+
+/* Forwards every call to the wrapped builder and records it. */
+class IniDBSnapshotRecorder : public IniDBBuilder
+{
+public:
+  IniDBSnapshotRecorder (IniDBBuilder &);
+  /* Only record, e.g. while parsing on another thread; the calls are
+     applied later with IniDBSnapshot::replay (). */
+  IniDBSnapshotRecorder ();
+  virtual ~IniDBSnapshotRecorder ();
+
+  /* Must be called before each setup file is parsed; sets parse_mirror on
+     the wrapped builder. */
+  void beginIni (const std::string& mirror);
+  /* Must be called after each setup file was parsed successfully, with
+     the SHA-512 digest of its uncompressed text. */
+  void endIni (unsigned char const digest[SHA512_DIGEST_LENGTH]);
+  /* Add the calls recorded by another recorder, as if made here. */
+  void append (IniDBSnapshotRecorder const &);
+  /* The recorded stream, ready for IniDBSnapshot::save (). */
+  const std::string& data () const { return _data; }
+
+  virtual void buildTimestamp (const std::string& );
+  virtual void buildVersion (const std::string& );
+  virtual void buildPackage (const std::string& );
+  virtual void buildPackageVersion (const std::string& );
+  virtual void buildPackageSDesc (const std::string& );
+  virtual void buildPackageLDesc (const std::string& );
+  virtual void buildPackageInstall (const std::string& );
+  virtual void buildPackageSource (const std::string&, const std::string&);
+  virtual void buildSourceFile (unsigned char const[16],
+				const std::string&, const std::string&);
+  virtual void buildPackageTrust (int);
+  virtual void buildPackageCategory (const std::string& );
+  virtual void buildBeginDepends ();
+  virtual void buildBeginPreDepends ();
+  virtual void buildPriority (const std::string& );
+  virtual void buildInstalledSize (const std::string& );
+  virtual void buildMaintainer (const std::string& );
+  virtual void buildArchitecture (const std::string& );
+  virtual void buildInstallSize (const std::string& );
+  virtual void buildInstallSHA512 (unsigned char const[64]);
+  virtual void buildSourceSHA512 (unsigned char const[64]);
+  virtual void buildInstallMD5 (unsigned char const[16]);
+  virtual void buildSourceMD5 (unsigned char const[16]);
+  virtual void buildBeginRecommends ();
+  virtual void buildBeginSuggests ();
+  virtual void buildBeginReplaces ();
+  virtual void buildBeginConflicts ();
+  virtual void buildBeginProvides ();
+  virtual void buildBeginBuildDepends ();
+  virtual void buildBeginBinary ();
+  virtual void buildDescription (const std::string& );
+  virtual void buildSourceName (const std::string& );
+  virtual void buildSourceNameVersion (const std::string& );
+  virtual void buildPackageListAndNode ();
+  virtual void buildPackageListOrNode (const std::string& );
+  virtual void buildPackageListOperator (PackageSpecification::_operators const &);
+  virtual void buildPackageListOperatorVersion (const std::string& );
+  virtual void buildMessage (const std::string&, const std::string&);
+
+private:
+  friend class IniDBSnapshot;
+  void op (unsigned char);
+  void str (const std::string& );
+  void bytes (unsigned char const *, size_t);
+  IniDBBuilder *_builder;
+  std::string _data;
+};
+
+class IniDBSnapshot
+{
+public:
+  /* Incrementally compute the key of a set of setup files.  Feed every
+     file, in parse order, together with the mirror it came from. */
+  IniDBSnapshot ();
+  void addIni (const std::string& mirror, io_stream *);
+  void digest (unsigned char [SHA512_DIGEST_LENGTH]);
+
+  /* Called after each replayed setup file, like endIni () above. */
+  typedef void (*iniDoneFn) (IniDBBuilder const &);
+
+  /* Replay the snapshot at url into builder if its key matches digest,
+     or whatever its key if digest is NULL.  Returns the number of setup
+     files replayed, or 0 if there is no usable snapshot; in that case
+     builder has not been touched.  With DescriptionText::lazy the snapshot
+     is kept for the descriptions to refer into. */
+  static int load (const std::string& url,
+		   unsigned char const digest[SHA512_DIGEST_LENGTH],
+		   IniDBBuilder &builder, iniDoneFn done = 0);
+  /* Apply the calls recorded by a record-only recorder to builder; with
+     DescriptionText::lazy, a copy of the recording is kept as by load ().
+     Returns the number of setup files replayed. */
+  static int replay (IniDBSnapshotRecorder const &,
+		     IniDBBuilder &builder, iniDoneFn done = 0);
+  /* Record in result the setup file of mirror with the digest base, as
+     kept in the snapshot at url whatever its key, updated by a
+     setup.ini.delta (see IniDelta.h): changes is the recording of a file
+     of the new header and the changed stanzas only, order the packages of
+     the new file and digest its digest.  Returns false if the snapshot
+     doesn't have that file or a package of order is in neither. */
+  static bool patch (const std::string& url, const std::string& mirror,
+		     unsigned char const base[SHA512_DIGEST_LENGTH],
+		     IniDBSnapshotRecorder const &changes,
+		     std::vector<std::string> const &order,
+		     unsigned char const digest[SHA512_DIGEST_LENGTH],
+		     IniDBSnapshotRecorder &result);
+  /* 0 on success */
+  static int save (const std::string& url,
+		   unsigned char const digest[SHA512_DIGEST_LENGTH],
+		   IniDBSnapshotRecorder const &);
+private:
+  SHA2_CTX ctx;
+};
+
+#endif /* SETUP_INIDBSNAPSHOT_H */
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#include "IniDelta.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <list>
+#include <map>
+
+#define DELTA_MAGIC "setup.ini delta 1"
+
+void
+IniDelta::digest (const std::string& text,
+		  unsigned char result[SHA512_DIGEST_LENGTH])
+{
+  SHA2_CTX ctx;
+  SHA512Init (&ctx);
+  SHA512Update (&ctx, (unsigned char const *) text.data (), text.size ());
+  SHA512Final (result, &ctx);
+}
+
+static bool
+parse_hex (const std::string& hex, unsigned char *result, size_t len)
+{
+  if (hex.size () != len * 2)
+    return false;
+  for (size_t i = 0; i < len; ++i)
+    {
+      char byte[3] = { hex[2 * i], hex[2 * i + 1], 0 };
+      char *end;
+      result[i] = strtoul (byte, &end, 16);
+      if (end != byte + 2)
+	return false;
+    }
+  return true;
+}
+
+class DeltaReader
+{
+public:
+  DeltaReader (const std::string& aText) : text (aText), pos (0) {}
+  bool atEnd () const { return pos >= text.size (); }
+  /* The next line, split at spaces. */
+  bool line (std::vector<std::string> &words)
+  {
+    words.clear ();
+    size_t eol = text.find ('\n', pos);
+    if (eol == std::string::npos)
+      return false;
+    while (pos < eol)
+      {
+	size_t sp = text.find (' ', pos);
+	if (sp == std::string::npos || sp > eol)
+	  sp = eol;
+	words.push_back (text.substr (pos, sp - pos));
+	pos = sp < eol ? sp + 1 : eol;
+      }
+    pos = eol + 1;
+    return true;
+  }
+  bool block (const std::string& size, std::string &result)
+  {
+    char *end;
+    unsigned long len = strtoul (size.c_str (), &end, 10);
+    if (!size.size () || *end || len > text.size () - pos)
+      return false;
+    result = text.substr (pos, len);
+    pos += len;
+    return true;
+  }
+private:
+  const std::string& text;
+  size_t pos;
+};
+
+bool
+IniDelta::parse (const std::string& text)
+{
+  DeltaReader in (text);
+  std::vector<std::string> w;
+  ops.clear ();
+  if (!in.line (w) || w.size () != 3
+      || w[0] + " " + w[1] + " " + w[2] != DELTA_MAGIC)
+    return false;
+  if (!in.line (w) || w.size () != 2 || w[0] != "base"
+      || !parse_hex (w[1], base_digest, SHA512_DIGEST_LENGTH))
+    return false;
+  if (!in.line (w) || w.size () != 2 || w[0] != "result"
+      || !parse_hex (w[1], result_digest, SHA512_DIGEST_LENGTH))
+    return false;
+  if (!in.line (w) || w.size () != 2 || w[0] != "header"
+      || !in.block (w[1], header))
+    return false;
+  while (!in.atEnd ())
+    {
+      op anOp;
+      if (!in.line (w))
+	return false;
+      if (w.size () == 2 && w[0] == "remove")
+	anOp.type = REMOVE;
+      else if (w.size () == 3 && w[0] == "replace")
+	anOp.type = REPLACE;
+      else if (w.size () == 3 && w[0] == "add")
+	anOp.type = ADD;
+      else
+	return false;
+      anOp.name = w[1];
+      if (w.size () == 3 && !in.block (w[2], anOp.stanza))
+	return false;
+      ops.push_back (anOp);
+    }
+  return true;
+}
+
+/* The package a stanza is for. */
+static std::string
+stanza_name (const std::string& stanza)
+{
+  if (stanza.compare (0, 2, "@ "))
+    return std::string ();
+  size_t eol = stanza.find ('\n');
+  return stanza.substr (2, eol == std::string::npos ? eol : eol - 2);
+}
+
+struct stanza
+{
+  stanza (const std::string& aName, const std::string& aText,
+	  bool isChanged) :
+    name (aName), text (aText), changed (isChanged) {}
+  std::string name;
+  std::string text;
+  bool changed;
+};
+typedef std::list<stanza> StanzaList;
+
+bool
+IniDelta::apply (const std::string& base, std::string &result,
+		 std::vector<std::string> &order, std::string &changes) const
+{
+  unsigned char d[SHA512_DIGEST_LENGTH];
+  digest (base, d);
+  if (memcmp (d, base_digest, SHA512_DIGEST_LENGTH))
+    return false;
+
+  /* Split the base file into its stanzas. */
+  StanzaList stanzas;
+  std::map<std::string, StanzaList::iterator> index;
+  size_t start = std::string::npos;
+  for (size_t p = 0; p <= base.size (); ++p)
+    {
+      bool at_stanza = p + 1 < base.size () && base[p] == '@'
+		       && base[p + 1] == ' '
+		       && (p == 0 || (p >= 2 && base[p - 1] == '\n'
+				      && base[p - 2] == '\n'));
+      if (!at_stanza && p != base.size ())
+	continue;
+      if (start != std::string::npos)
+	{
+	  std::string text = base.substr (start, p - start);
+	  std::string name = stanza_name (text);
+	  if (index.count (name))
+	    return false;
+	  index[name] = stanzas.insert (stanzas.end (),
+					stanza (name, text, false));
+	}
+      start = p;
+    }
+
+  for (std::vector<op>::const_iterator o = ops.begin (); o != ops.end (); ++o)
+    {
+      std::map<std::string, StanzaList::iterator>::iterator i =
+	index.find (o->name);
+      switch (o->type)
+	{
+	case REMOVE:
+	  if (i == index.end ())
+	    return false;
+	  stanzas.erase (i->second);
+	  index.erase (i);
+	  break;
+	case REPLACE:
+	  if (i == index.end () || stanza_name (o->stanza) != o->name)
+	    return false;
+	  i->second->text = o->stanza;
+	  i->second->changed = true;
+	  break;
+	case ADD:
+	  {
+	    std::string name = stanza_name (o->stanza);
+	    if (!name.size () || index.count (name)
+		|| (o->name != "-" && i == index.end ()))
+	      return false;
+	    StanzaList::iterator at = stanzas.begin ();
+	    if (o->name != "-")
+	      at = ++StanzaList::iterator (i->second);
+	    index[name] = stanzas.insert (at, stanza (name, o->stanza, true));
+	  }
+	  break;
+	}
+    }
+
+  result = header;
+  changes = header;
+  order.clear ();
+  for (StanzaList::const_iterator s = stanzas.begin (); s != stanzas.end ();
+       ++s)
+    {
+      result += s->text;
+      order.push_back (s->name);
+      if (s->changed)
+	{
+	  changes += s->text;
+	  if (s->text.size () && s->text[s->text.size () - 1] != '\n')
+	    changes += '\n';
+	}
+    }
+
+  digest (result, d);
+  return !memcmp (d, result_digest, SHA512_DIGEST_LENGTH);
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#ifndef SETUP_INIDELTA_H
+#define SETUP_INIDELTA_H
+
+/* setup.ini.delta: the changes between two setup.ini files, by package.
+ *
+ * A setup.ini is a header followed by package stanzas; a stanza runs from
+ * a line "@ name" at the start of the file or after an empty line up to
+ * the next one.  A delta is made against one particular base file and
+ * says how to turn it into one particular result file, byte for byte, so
+ * that the result can be checked against the signature of the real thing:
+ *
+ *   setup.ini delta 1
+ *   base <SHA-512 of the base file, in hex>
+ *   result <SHA-512 of the result file, in hex>
+ *   header <n>
+ *   <n bytes: the new header>
+ *   remove <name>
+ *   replace <name> <n>
+ *   <n bytes: the new stanza of package name>
+ *   add <name> <n>
+ *   <n bytes: a new stanza, which goes right after that of package name,
+ *    or first if name is "-">
+ *
+ * Each line ends in a newline; the operations after the header are
+ * applied in order.
+ */
+
+#include <string>
+#include <vector>
+#include "sha2.h"
+
+class IniDelta
+{
+public:
+  /* Returns false if text isn't a delta this version understands. */
+  bool parse (const std::string& text);
+
+  /* Apply the delta to base, the text of a setup.ini.  On success result
+     is the new file, order lists the packages in it and changes is a
+     setup.ini made of just the new header and the stanzas that were added
+     or replaced.  Fails unless base is the file the delta was made
+     against and the result is the file it was made for. */
+  bool apply (const std::string& base, std::string &result,
+	      std::vector<std::string> &order, std::string &changes) const;
+
+  unsigned char base_digest[SHA512_DIGEST_LENGTH];
+  unsigned char result_digest[SHA512_DIGEST_LENGTH];
+
+  static void digest (const std::string& text,
+		      unsigned char result[SHA512_DIGEST_LENGTH]);
+private:
+  enum op_type { REMOVE, REPLACE, ADD };
+  struct op
+  {
+    op_type type;
+    std::string name;	/* for ADD, the package it goes after */
+    std::string stanza;
+  };
+  std::string header;
+  std::vector<op> ops;
+};
+
+#endif /* SETUP_INIDELTA_H */
@@ -72,23 +72,37 @@ struct LogEnt
 
 static LogEnt *first_logent = 0;
 static LogEnt **next_logent = &first_logent;
-static LogEnt *currEnt = 0;
 
 int LogFile::exit_msg = 0;
 
 typedef set<filedef> FileSet;
 static FileSet files;
-static stringbuf *theStream;
+
+/* An entry being written.  Each thread writes its own, kept in entry_slot
+   until its endLog, so one left unfinished (by an exception, say) holds up
+   no other thread.  entry_lock is only held while a finished entry is
+   added to the list. */
+class LogEntryStream : public std::ostream
+{
+public:
+  LogEntryStream () : std::ostream (&text) {}
+  std::stringbuf text;
+  enum log_level level;
+};
+
+static DWORD entry_slot;
+static CRITICAL_SECTION entry_lock;
 
 LogFile *
 LogFile::createLogFile()
 {
-    theStream = new std::stringbuf;
-    return new LogFile(theStream);
+    return new LogFile(new std::stringbuf);
 }
 
 LogFile::LogFile(std::stringbuf *aStream) : LogSingleton (aStream) 
 {
+  entry_slot = TlsAlloc ();
+  InitializeCriticalSection (&entry_lock);
 }
 LogFile::~LogFile(){}
 
@@ -208,32 +222,33 @@ LogFile::operator() (log_level theLevel)
 {
   if (theLevel < 1 || theLevel > 2)
     throw new invalid_argument("Invalid log_level");
-  if (!theStream)
-    theStream = new std::stringbuf;
-  rdbuf (theStream);
-  currEnt = new LogEnt;
-  currEnt->next = 0;
-  currEnt->level = theLevel;
-  return *this;
+  LogEntryStream *entry = (LogEntryStream *) TlsGetValue (entry_slot);
+  if (!entry)
+    {
+      entry = new LogEntryStream;
+      TlsSetValue (entry_slot, entry);
+    }
+  entry->level = theLevel;
+  return *entry;
 }
 
 void
 LogFile::endEntry()
 {
-  string buf = theStream->str();
-  delete theStream;
+  LogEntryStream *entry = (LogEntryStream *) TlsGetValue (entry_slot);
+  TlsSetValue (entry_slot, NULL);
+
+  LogEnt *currEnt = new LogEnt;
+  currEnt->next = 0;
+  currEnt->level = entry ? entry->level : LOG_PLAIN;
+  string buf = entry ? entry->text.str () : string ();
+  delete entry;
 
+  EnterCriticalSection (&entry_lock);
   /* also write to stdout */
   if ((currEnt->level >= LOG_PLAIN) || VerboseOutput)
     cout << buf << endl;
 
-  if (!currEnt)
-    {
-      /* get a default LogEnt */
-      currEnt = new LogEnt;
-      currEnt->next = 0;
-      currEnt->level = LOG_PLAIN;
-    }
   *next_logent = currEnt;
   next_logent = &(currEnt->next);
   time (&(currEnt->when));
@@ -248,9 +263,5 @@ LogFile::endEntry()
    * non-0 memory on alloc
    */
   currEnt->msg += buf;
-
-  /* reset for next use */
-  theStream = new std::stringbuf;
-  rdbuf (theStream);
-  init (theStream);
+  LeaveCriticalSection (&entry_lock);
 }
@@ -24,8 +24,9 @@ using namespace std;
 /* End of a Log comment */
 ostream& endLog(ostream& outs)
 {
-  /* Doesn't seem to be any way around this */
-  dynamic_cast<LogSingleton &>(outs).endEntry();
+  /* outs may be a stream the log keeps for the entry, rather than the log
+     itself */
+  LogSingleton::GetInstance ().endEntry ();
   return outs;
 }
 
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#ifndef SETUP_NULLLOG_H
+#define SETUP_NULLLOG_H
+
+/* A log that drops everything: the package database logs as it goes,
+ * which inilint --bench and the tests have no use for. */
+
+#include <stdlib.h>
+#include "LogSingleton.h"
+
+class NullLog : public LogSingleton
+{
+public:
+  NullLog () : LogSingleton (&discard) {}
+  virtual void exit (int exit_code, bool = true) { ::exit (exit_code); }
+  virtual std::ostream &operator() (enum log_level) { return *this; }
+protected:
+  virtual void endEntry () {}
+private:
+  class Discard : public std::streambuf
+  {
+  protected:
+    virtual int overflow (int c) { return c; }
+  } discard;
+};
+
+#endif /* SETUP_NULLLOG_H */
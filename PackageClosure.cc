@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#include "PackageClosure.h"
+
+#include <algorithm>
+#include "LogSingleton.h"
+#include "package_db.h"
+#include "package_meta.h"
+
+void
+PackageClosure::Set::merge (Set const &other)
+{
+  if (words.size () < other.words.size ())
+    words.resize (other.words.size (), 0);
+  for (size_t w = 0; w < other.words.size (); ++w)
+    words[w] |= other.words[w];
+}
+
+size_t
+PackageClosure::Set::size () const
+{
+  size_t count = 0;
+  for (size_t w = 0; w < words.size (); ++w)
+    count += __builtin_popcountll (words[w]);
+  return count;
+}
+
+PackageClosure::PackageClosure (trusts deftrust) :
+  trust (deftrust), ids (0), walk (0)
+{
+}
+
+/* The package set_requirements () would install for clause, with nothing
+   installed; npos if there is none. */
+static PackageCollection::id_type
+needed (DependencyGraph::index_type clause)
+{
+  DependencyGraph &graph = packagedb::graph;
+  for (DependencyGraph::index_type a = graph.alternativeBegin (clause);
+       a != graph.alternativeEnd (clause); ++a)
+    {
+      packagemeta *pkg = graph.package (a);
+      if (pkg && graph.spec (a)->satisfyingVersions (pkg->versions))
+	return graph.target (a);
+    }
+  if (packagedb::providers.empty ())
+    return PackageCollection::npos;
+  for (DependencyGraph::index_type a = graph.alternativeBegin (clause);
+       a != graph.alternativeEnd (clause); ++a)
+    {
+      ProviderIndex::range r = packagedb::providers.find (*graph.spec (a));
+      for (ProviderIndex::const_iterator p = r.first; p != r.second; ++p)
+	if (packagedb::packages[p->id]
+	    && graph.spec (a)->satisfiedBy (*p->provided))
+	  return p->id;
+    }
+  return PackageCollection::npos;
+}
+
+void
+PackageClosure::build ()
+{
+  packagedb db;
+  ids = db.packages.ids ();
+  starts.assign (1, 0);
+  needs.clear ();
+  for (id_type id = 0; id < ids; ++id)
+    {
+      packagemeta *pkg = db.packages[id];
+      packageversion version;
+      if (pkg)
+	version = pkg->trustp (false, trust);
+      if (version)
+	{
+	  DependencyGraph::index_type node = version.dependencyNode ();
+	  for (DependencyGraph::index_type c = db.graph.clauseBegin (node);
+	       c != db.graph.clauseEnd (node); ++c)
+	    {
+	      id_type need = needed (c);
+	      if (need != PackageCollection::npos && need != id)
+		needs.push_back (need);
+	    }
+	}
+      starts.push_back (needs.size ());
+    }
+  findComponents ();
+  Log (LOG_BABBLE) << "Package closures: " << ids << " packages, "
+		   << needs.size () << " needed, " << closures.size ()
+		   << " strongly connected components" << endLog;
+}
+
+/* Tarjan's algorithm, without recursion, as in ConnectedLoopFinder: a
+   component is finished after all it needs, so it is numbered after
+   them. */
+void
+PackageClosure::findComponents ()
+{
+  const uint32_t finished = (uint32_t) -1;
+  /* by package id: when it was first reached, and the earliest package
+     reachable from it still on stack */
+  std::vector<uint32_t> visitOrder (ids, 0), lowLink (ids, 0);
+  std::vector<id_type> stack;
+  /* the packages being visited, and the next of their needs to follow */
+  struct Frame
+  {
+    id_type id;
+    uint32_t next;
+  };
+  std::vector<Frame> frames;
+  uint32_t visited = 0, components = 0;
+  component.assign (ids, 0);
+
+  for (id_type root = 0; root < ids; ++root)
+    {
+      if (visitOrder[root])
+	continue;
+      visitOrder[root] = lowLink[root] = ++visited;
+      stack.push_back (root);
+      Frame first = { root, starts[root] };
+      frames.push_back (first);
+      while (!frames.empty ())
+	{
+	  id_type id = frames.back ().id;
+	  if (frames.back ().next < starts[id + 1])
+	    {
+	      id_type need = needs[frames.back ().next++];
+	      if (!visitOrder[need])
+		{
+		  visitOrder[need] = lowLink[need] = ++visited;
+		  stack.push_back (need);
+		  Frame frame = { need, starts[need] };
+		  frames.push_back (frame);
+		}
+	      else if (visitOrder[need] != finished)
+		lowLink[id] = std::min (lowLink[id], visitOrder[need]);
+	      continue;
+	    }
+	  frames.pop_back ();
+	  if (!frames.empty ())
+	    lowLink[frames.back ().id] = std::min (lowLink[frames.back ().id],
+						   lowLink[id]);
+	  if (lowLink[id] != visitOrder[id])
+	    continue;
+	  id_type popped;
+	  do
+	    {
+	      popped = stack.back ();
+	      stack.pop_back ();
+	      component[popped] = components;
+	      visitOrder[popped] = finished;
+	    }
+	  while (popped != id);
+	  ++components;
+	}
+    }
+
+  memberStarts.assign (components + 1, 0);
+  for (id_type id = 0; id < ids; ++id)
+    ++memberStarts[component[id] + 1];
+  for (uint32_t c = 0; c < components; ++c)
+    memberStarts[c + 1] += memberStarts[c];
+  std::vector<uint32_t> next (memberStarts.begin (), memberStarts.end () - 1);
+  members.resize (ids);
+  for (id_type id = 0; id < ids; ++id)
+    members[next[component[id]]++] = id;
+
+  closures.assign (components, Set ());
+  reached.assign (components, 0);
+  walk = 0;
+}
+
+/* Add the packages of the components todo and all they need to result,
+   merging the closures known instead of walking them. */
+void
+PackageClosure::walkFrom (std::vector<uint32_t> &todo, Set &result)
+{
+  if (!++walk)
+    {
+      /* Wrapped around; the marks of long ago would look current. */
+      reached.assign (reached.size (), 0);
+      walk = 1;
+    }
+  for (size_t t = 0; t < todo.size (); ++t)
+    reached[todo[t]] = walk;
+  while (!todo.empty ())
+    {
+      uint32_t d = todo.back ();
+      todo.pop_back ();
+      if (!closures[d].words.empty ())
+	{
+	  result.merge (closures[d]);
+	  continue;
+	}
+      for (uint32_t m = memberStarts[d]; m < memberStarts[d + 1]; ++m)
+	{
+	  id_type id = members[m];
+	  result.add (id);
+	  for (uint32_t n = starts[id]; n < starts[id + 1]; ++n)
+	    {
+	      uint32_t e = component[needs[n]];
+	      if (reached[e] != walk)
+		{
+		  reached[e] = walk;
+		  todo.push_back (e);
+		}
+	    }
+	}
+    }
+}
+
+PackageClosure::Set const &
+PackageClosure::of (id_type id)
+{
+  uint32_t c = component[id];
+  if (closures[c].words.empty ())
+    {
+      std::vector<uint32_t> todo (1, c);
+      Set result;
+      result.clear (ids);
+      walkFrom (todo, result);
+      closures[c].words.swap (result.words);
+    }
+  return closures[c];
+}
+
+void
+PackageClosure::of (std::vector<id_type> const &roots, Set &result)
+{
+  /* one walk for all of them, so that what several need is walked once;
+     only the closures of single packages are kept */
+  std::vector<uint32_t> todo;
+  for (size_t r = 0; r < roots.size (); ++r)
+    todo.push_back (component[roots[r]]);
+  result.clear (ids);
+  walkFrom (todo, result);
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#ifndef SETUP_PACKAGECLOSURE_H
+#define SETUP_PACKAGECLOSURE_H
+
+/* What installing packages would pull in, worked out without selecting
+ * anything: packagemeta::set_requirements () answers that too, but by
+ * changing packagemeta::desired as it goes.
+ *
+ * build () reduces the database to one edge from each package to each
+ * package it needs, following the depends of the version trustp () gives
+ * the way set_requirements () would with nothing installed: for each
+ * clause, the first alternative some version of which meets it, else the
+ * first version providing one.  The strongly connected components of
+ * that graph are found once, and numbered so that a component only ever
+ * needs those numbered below it.
+ *
+ * A closure is a bitset over the package ids, worked out for a component
+ * the first time a member is asked for and kept: the packages of the
+ * components reached are added one by one, unless a component's closure
+ * is known, which is merged in a word at a time instead of being walked
+ * again.  Each closure kept takes a bit per package, so they are kept for
+ * what is asked for only, not for everything passed on the way.  The
+ * closure of many packages together is one walk, which goes through what
+ * they all need once.
+ */
+
+#include <stdint.h>
+#include <vector>
+#include "PackageCollection.h"
+#include "PackageTrust.h"
+
+class PackageClosure
+{
+public:
+  typedef PackageCollection::id_type id_type;
+
+  /* A set of package ids. */
+  class Set
+  {
+  public:
+    bool has (id_type id) const
+    {
+      return id / 64 < words.size () && ((words[id / 64] >> (id % 64)) & 1);
+    }
+    void add (id_type id) { words[id / 64] |= (uint64_t) 1 << id % 64; }
+    void merge (Set const &other);
+    /* how many ids it holds */
+    size_t size () const;
+    /* Hold none, with room for ids. */
+    void clear (id_type ids) { words.assign ((ids + 63) / 64, 0); }
+  private:
+    friend class PackageClosure;
+    std::vector<uint64_t> words;
+  };
+
+  PackageClosure (trusts deftrust);
+
+  /* Index the packages as they are now, forgetting all closures. */
+  void build ();
+
+  /* The packages installing the package id pulls in, itself included. */
+  Set const &of (id_type id);
+  /* The packages installing all of roots pulls in. */
+  void of (std::vector<id_type> const &roots, Set &closure);
+
+  size_t components () const { return closures.size (); }
+private:
+  void findComponents ();
+  void walkFrom (std::vector<uint32_t> &todo, Set &result);
+
+  trusts trust;
+  id_type ids;
+  /* by package id, the packages it needs, in compressed sparse rows */
+  std::vector<uint32_t> starts;
+  std::vector<id_type> needs;
+  /* by package id, its component */
+  std::vector<uint32_t> component;
+  /* by component, its packages, in compressed sparse rows too */
+  std::vector<uint32_t> memberStarts;
+  std::vector<id_type> members;
+  /* by component, its closure, empty until asked for */
+  std::vector<Set> closures;
+  /* by component, the last walk that reached it */
+  std::vector<uint32_t> reached;
+  uint32_t walk;
+};
+
+#endif /* SETUP_PACKAGECLOSURE_H */
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#include "PackageCollection.h"
+
+#include <algorithm>
+#include "package_meta.h"
+
+const PackageCollection::id_type PackageCollection::npos;
+
+/* FNV-1a */
+size_t
+PackageCollection::hash (const std::string& name)
+{
+  uint32_t h = 2166136261U;
+  for (std::string::const_iterator c = name.begin (); c != name.end (); ++c)
+    {
+      h ^= (unsigned char) *c;
+      h *= 16777619U;
+    }
+  return h;
+}
+
+PackageCollection::id_type
+PackageCollection::id (const std::string& name) const
+{
+  if (slots.empty ())
+    return npos;
+  size_t mask = slots.size () - 1;
+  for (size_t s = hash (name) & mask; slots[s]; s = (s + 1) & mask)
+    if (entries[slots[s] - 1].first == name)
+      return slots[s] - 1;
+  return npos;
+}
+
+std::pair<PackageCollection::id_type, bool>
+PackageCollection::insert (packagemeta *pkg)
+{
+  const std::string &name = pkg->name;
+  /* keep the table at most half full */
+  if (2 * (live + 1) > slots.size ())
+    grow ();
+  size_t mask = slots.size () - 1;
+  size_t s = hash (name) & mask;
+  for (; slots[s]; s = (s + 1) & mask)
+    if (entries[slots[s] - 1].first == name)
+      return std::make_pair (slots[s] - 1, false);
+
+  id_type i = entries.size ();
+  entries.push_back (value_type (name, pkg));
+  slots[s] = i + 1;
+  order.push_back (i);
+  ++live;
+  sorted = false;
+  return std::make_pair (i, true);
+}
+
+void
+PackageCollection::grow ()
+{
+  std::vector<id_type> old;
+  old.swap (slots);
+  slots.resize (old.empty () ? 64 : 2 * old.size (), 0);
+  size_t mask = slots.size () - 1;
+  for (std::vector<id_type>::iterator o = old.begin (); o != old.end (); ++o)
+    if (*o)
+      {
+	size_t s = hash (entries[*o - 1].first) & mask;
+	while (slots[s])
+	  s = (s + 1) & mask;
+	slots[s] = *o;
+      }
+}
+
+void
+PackageCollection::erase (iterator i)
+{
+  id_type gone = order[i.pos];
+  size_t mask = slots.size () - 1;
+  size_t s = hash (entries[gone].first) & mask;
+  while (slots[s] != gone + 1)
+    s = (s + 1) & mask;
+
+  /* Shift later members of the probe run back into the hole, so lookups
+     never stop short of them. */
+  for (size_t next = (s + 1) & mask; slots[next]; next = (next + 1) & mask)
+    {
+      size_t home = hash (entries[slots[next] - 1].first) & mask;
+      /* does the hole lie between home and next, cyclically? */
+      if (((next - home) & mask) >= ((next - s) & mask))
+	{
+	  slots[s] = slots[next];
+	  s = next;
+	}
+    }
+  slots[s] = 0;
+
+  /* the id stays allocated; the entry is skipped by iterators */
+  entries[gone].second = NULL;
+  --live;
+}
+
+void
+PackageCollection::clear ()
+{
+  entries.clear ();
+  slots.clear ();
+  order.clear ();
+  live = 0;
+  sorted = true;
+}
+
+void
+PackageCollection::sort ()
+{
+  if (sorted)
+    return;
+  /* drop the erased packages while at it */
+  std::vector<id_type>::iterator last =
+    std::remove_if (order.begin (), order.end (),
+		    [this] (id_type i) { return !entries[i].second; });
+  order.erase (last, order.end ());
+  std::sort (order.begin (), order.end (),
+	     [this] (id_type a, id_type b)
+	     { return entries[a].first < entries[b].first; });
+  sorted = true;
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#ifndef SETUP_PACKAGECOLLECTION_H
+#define SETUP_PACKAGECOLLECTION_H
+
+/* The packages of the package database, by name.
+ *
+ * Packages are kept in a dense vector in the order they were added, and
+ * the position of a package in it is its id: ids are never reused or
+ * moved until clear (), so they can index side tables.  Names are looked
+ * up in an open addressing hash table of ids, with linear probing.  A
+ * package is kept under its packagemeta::name, which is interned, so the
+ * entries refer to that instead of holding a copy of every name.
+ *
+ * Iterating gives the packages sorted by name, like the std::map this
+ * replaces; the sorted order is only built when it is first asked for
+ * after an insert.  An insert invalidates all iterators, an erase only
+ * those to the erased package, so "erase (i++)" works as with a map.
+ */
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+class packagemeta;
+
+class PackageCollection
+{
+public:
+  typedef uint32_t id_type;
+  typedef std::pair<const std::string &, packagemeta *> value_type;
+  static const id_type npos = (id_type) -1;
+
+  class iterator
+  {
+  public:
+    iterator () : c (NULL), pos (0) {}
+    value_type &operator* () const { return c->entries[c->order[pos]]; }
+    value_type *operator-> () const { return &**this; }
+    iterator &operator++ () { ++pos; skip (); return *this; }
+    iterator operator++ (int) { iterator old (*this); ++*this; return old; }
+    bool operator== (iterator const &rhs) const { return pos == rhs.pos; }
+    bool operator!= (iterator const &rhs) const { return pos != rhs.pos; }
+    id_type id () const { return c->order[pos]; }
+  private:
+    friend class PackageCollection;
+    iterator (PackageCollection *aCollection, size_t aPos) :
+      c (aCollection), pos (aPos) { skip (); }
+    /* step over erased packages */
+    void skip ()
+    {
+      while (pos < c->order.size () && !c->entries[c->order[pos]].second)
+	++pos;
+    }
+    PackageCollection *c;
+    size_t pos;
+  };
+
+  PackageCollection () : live (0), sorted (true) {}
+
+  /* Add pkg under its name.  Returns its id, and false if there already
+     was a package of that name, which is left as it is. */
+  std::pair<id_type, bool> insert (packagemeta *pkg);
+  /* The package called name, or NULL. */
+  packagemeta *find (const std::string& name) const
+  {
+    id_type i = id (name);
+    return i == npos ? NULL : entries[i].second;
+  }
+  /* The id of the package called name, or npos. */
+  id_type id (const std::string& name) const;
+  /* The package with the given id, NULL if it was erased. */
+  packagemeta *operator[] (id_type i) const { return entries[i].second; }
+  /* One more than the largest id handed out. */
+  id_type ids () const { return entries.size (); }
+
+  /* Forget a package; it is not deleted. */
+  void erase (iterator i);
+  void clear ();
+  size_t size () const { return live; }
+  bool empty () const { return !live; }
+
+  iterator begin () { sort (); return iterator (this, 0); }
+  iterator end () { sort (); return iterator (this, order.size ()); }
+private:
+  static size_t hash (const std::string& name);
+  void grow ();
+  void sort ();
+
+  std::vector<value_type> entries;
+  /* id + 1 of the package hashed to each slot, 0 if the slot is free;
+     the size is always a power of two */
+  std::vector<id_type> slots;
+  /* ids of the live packages, sorted by name when sorted is set */
+  std::vector<id_type> order;
+  size_t live;
+  bool sorted;
+};
+
+#endif /* SETUP_PACKAGECOLLECTION_H */
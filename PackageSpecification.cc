@@ -22,14 +22,15 @@ static const char *cvsid = "\n%%% $Id$\n";
 #include "package_version.h"
 
 PackageSpecification::PackageSpecification (const std::string& packageName)
-  : _packageName (packageName) , _operator (0), _version ()
+  : _packageName (&StringPool::intern (packageName)) , _operator (0),
+    _version (&StringPool::empty ()), _versionKey (&StringPool::empty ())
 {
 }
 
 const std::string&
 PackageSpecification::packageName () const
 {
-  return _packageName;
+  return *_packageName;
 }
 
 void
@@ -41,24 +42,73 @@ PackageSpecification::setOperator (_operators const &anOperator)
 void
 PackageSpecification::setVersion (const std::string& aVersion)
 {
-  _version = aVersion;
+  _version = &StringPool::intern (aVersion);
+  /* made once here, so no check has to compare version strings */
+  _versionKey
+    = &StringPool::intern (packageversion::canonicalVersionKey (aVersion));
 }
 
 bool
 PackageSpecification::satisfies (packageversion const &aPackage) const
 {
-  if (casecompare(_packageName, aPackage.Name()) != 0)
-    return false;
-  if (_operator && _version.size() 
-      && !_operator->satisfies (aPackage.Canonical_version (), _version))
+  if (casecompare(*_packageName, aPackage.Name()) == 0)
+    return satisfiesVersion (aPackage);
+  PackageAndList const *provides
+    = const_cast<packageversion &> (aPackage).provides ();
+  for (PackageAndList::const_iterator o = provides->begin ();
+       o != provides->end (); ++o)
+    for (PackageOrList::const_iterator s = (*o)->begin (); s != (*o)->end ();
+	 ++s)
+      if (satisfiedBy (**s))
+	return true;
+  return false;
+}
+
+bool
+PackageSpecification::satisfiesVersion (packageversion const &aPackage) const
+{
+  if (_operator && _version->size()
+      && !_operator->accepts (aPackage.versionKey ().compare (*_versionKey)))
     return false;
   return true;
 }
 
+bool
+PackageSpecification::satisfiedBy (PackageSpecification const &provided) const
+{
+  if (_packageName != provided._packageName
+      && casecompare(*_packageName, *provided._packageName) != 0)
+    return false;
+  if (!_operator || !_version->size())
+    return true;
+  return provided._operator && *provided._operator == Equals
+    && provided._version->size()
+    && _operator->accepts (provided._versionKey->compare (*_versionKey));
+}
+
+size_t
+PackageSpecification::satisfyingVersions (std::set <packageversion> const &versions,
+					  std::vector <packageversion> *matches) const
+{
+  bool any = !_operator || !_version->size();
+  if (any && !matches)
+    return versions.size ();
+  size_t count = 0;
+  for (std::set <packageversion>::const_iterator i = versions.begin ();
+       i != versions.end (); ++i)
+    if (any || _operator->accepts (i->versionKey ().compare (*_versionKey)))
+      {
+	++count;
+	if (matches)
+	  matches->push_back (*i);
+      }
+  return count;
+}
+
 std::string
 PackageSpecification::serialise () const
 {
-  return _packageName;
+  return *_packageName;
 }
 
 PackageSpecification &
@@ -71,9 +121,9 @@ PackageSpecification::operator= (PackageSpecification const &rhs)
 std::ostream &
 operator << (std::ostream &os, PackageSpecification const &spec)
 {
-  os << spec._packageName;
+  os << *spec._packageName;
   if (spec._operator)
-    os << " " << spec._operator->caption() << " " << spec._version;
+    os << " " << spec._operator->caption() << " " << *spec._version;
   return os;
 }
 
@@ -104,21 +154,20 @@ PackageSpecification::_operators::caption () const
 }
 
 bool
-PackageSpecification::_operators::satisfies (const std::string& lhs,
-                                             const std::string& rhs) const
+PackageSpecification::_operators::accepts (int comparison) const
 {
   switch (_value)
     {
     case 0:
-      return casecompare(lhs, rhs) == 0;
+      return comparison == 0;
     case 1:
-      return casecompare(lhs, rhs) < 0;
+      return comparison < 0;
     case 2:
-      return casecompare(lhs, rhs) > 0;
+      return comparison > 0;
     case 3:
-      return casecompare(lhs, rhs) <= 0;
+      return comparison <= 0;
     case 4:
-      return casecompare(lhs, rhs) >= 0;
+      return comparison >= 0;
     }
   return false;
 }
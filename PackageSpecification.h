@@ -18,6 +18,10 @@
 
 #include <iosfwd>
 #include "String++.h"
+#include "StringPool.h"
+#include "Arena.h"
+#include <set>
+#include <vector>
 class packageversion;
 
 /* Describe a package - i.e. we need version 5 of apt */
@@ -25,7 +29,8 @@ class packageversion;
 class PackageSpecification
 {
 public:
-  PackageSpecification () : _packageName (), _operator(0) {}
+  PackageSpecification () : _packageName (&StringPool::empty ()), _operator(0),
+    _version (&StringPool::empty ()), _versionKey (&StringPool::empty ()) {}
   PackageSpecification (const std::string& packageName);
   ~PackageSpecification () {}
 
@@ -35,7 +40,25 @@ public:
   void setOperator (_operators const &);
   void setVersion (const std::string& );
 
+  /* true of a version of the package named, or of one that provides it */
   bool satisfies (packageversion const &) const;
+  /* satisfies (), for a version already known to be of the package named */
+  bool satisfiesVersion (packageversion const &) const;
+  /* true if the Provides: entry provided meets this: an unversioned
+     requirement is met by any entry for the name, a versioned one only by
+     an entry providing a version that meets it */
+  bool satisfiedBy (PackageSpecification const &provided) const;
+  /* How many of versions, all of the package named, satisfy this; those
+     that do are added to matches, unless that is NULL.  One pass, comparing
+     the versions' keys with this one's. */
+  size_t satisfyingVersions (std::set <packageversion> const &versions,
+			     std::vector <packageversion> *matches = NULL) const;
+  /* What is asked of the versions: the operator, NULL if any version will
+     do, and the interned key of the version it compares them with.  The
+     same for all specifications asking the same. */
+  _operators const *versionOperator () const
+    { return _version->size () ? _operator : NULL; }
+  const std::string &versionKey () const { return *_versionKey; }
   std::string serialise () const;
 
   PackageSpecification &operator= (PackageSpecification const &);
@@ -52,10 +75,12 @@ public:
 	  _value = 0;
       }
       _operators & operator ++ ();
-      bool operator == (_operators const &rhs) { return _value == rhs._value; }
-      bool operator != (_operators const &rhs) { return _value != rhs._value; }
+      bool operator == (_operators const &rhs) const { return _value == rhs._value; }
+      bool operator != (_operators const &rhs) const { return _value != rhs._value; }
       const char *caption () const;
-      bool satisfies (const std::string& lhs, const std::string& rhs) const;
+      /* true if the operator holds of a version that compares so (<0, 0
+	 or >0, as packageversion::compareVersions ()) to the one asked for */
+      bool accepts (int comparison) const;
     private:
       int _value;
     };
@@ -66,12 +91,22 @@ public:
   static const _operators MoreThanEquals;
 
 private:
-  std::string _packageName; /* foobar */
+  const std::string *_packageName; /* foobar, interned */
   _operators const * _operator; /* >= */
-  std::string _version;       /* 1.20 */
+  const std::string *_version; /* 1.20, interned */
+  /* packageversion::canonicalVersionKey () of _version, interned */
+  const std::string *_versionKey;
 };
 
 std::ostream &
 operator << (std::ostream &os, PackageSpecification const &);
 
+/* A dependency list: every clause of the AND list must be met by any of
+   the alternatives in its OR list.  The lists and their specifications
+   live in packagedb::dependencies, which is why PackageSpecification
+   must not own any memory of its own. */
+typedef std::vector <PackageSpecification *,
+		     ArenaAllocator <PackageSpecification *> > PackageOrList;
+typedef std::vector <PackageOrList *> PackageAndList;
+
 #endif /* SETUP_PACKAGESPECIFICATION_H */
@@ -127,6 +127,7 @@ PickPackageLine::click (int const myrow, int const ClickedRow, int const x)
       && x <= theView.headers[theView.new_col + 1].x - HMARGIN / 2)
     {
       pkg.set_action (theView.deftrust);
+      theView.selections.changed (&pkg);
       return 0;
     }
   if (x >= theView.headers[theView.bintick_col].x - HMARGIN / 2
@@ -148,11 +149,13 @@ PickPackageLine::click (int const myrow, int const ClickedRow, int const x)
      will not even show up in the "Pending" view! */
   if (!pkg.desired.picked () && !pkg.desired.sourcePackage ().picked ())
     pkg.desired = packageversion ();
+  theView.selections.changed (&pkg);
   return 0;
 }
 
 int PickPackageLine::set_action (packagemeta::_actions action)
 {
   pkg.set_action (action, pkg.trustp (true, theView.deftrust));
+  theView.selections.changed (&pkg);
   return 1;
 }
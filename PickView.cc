@@ -245,9 +245,9 @@ PickView::mode_caption (views mode)
 
 /* meant to be called on packagemeta::categories */
 bool
-isObsolete (set <std::string, casecompare_lt_op> &categories)
+isObsolete (set <pooled_string, casecompare_lt_op> &categories)
 {
-  set <std::string, casecompare_lt_op>::const_iterator i;
+  set <pooled_string, casecompare_lt_op>::const_iterator i;
   
   for (i = categories.begin (); i != categories.end (); ++i)
     if (isObsolete (*i))
@@ -455,7 +455,7 @@ PickView::init_headers (HDC dc)
       if (view_mode != PickView::views::Category && pkg.categories.size () > 2)
         {
           std::string compound_cat("");          
-          std::set<std::string, casecompare_lt_op>::const_iterator cat;
+          std::set<pooled_string, casecompare_lt_op>::const_iterator cat;
           size_t cnt;
           
           for (cnt = 0, cat = pkg.categories.begin (); 
@@ -657,7 +657,7 @@ PickView::set_vscroll_info (const RECT &r)
 LRESULT CALLBACK
 PickView::list_click (HWND hwnd, BOOL dblclk, int x, int y, UINT hitCode)
 {
-  int row, refresh __attribute__ ((unused));
+  int row, refresh;
 
   if (contents.itemcount () == 0)
     return 0;
@@ -674,31 +674,27 @@ PickView::list_click (HWND hwnd, BOOL dblclk, int x, int y, UINT hitCode)
 
   refresh = click (row, x);
 
-  // XXX we need a method to query the database to see if more
-  // than just one package has changed! Until then...
-#if 0
+  /* Select what the click asks for in turn.  If that changed no package
+     but the one clicked, only its row needs drawing again - unless the
+     package is listed under each of its categories. */
+  if (selections.resolve (deftrust).size () > 1
+      || view_mode == views::Category)
+    refresh = 1;
   if (refresh)
     {
-#endif
       RECT r = GetClientRect ();
       set_vscroll_info (r);
       InvalidateRect (GetHWND(), &r, TRUE);
-#if 0
     }
   else
     {
-      RECT rect;
-      rect.left =
-        headers[new_col].x - scroll_ulc_x;
-      rect.right =
-        headers[src_col + 1].x - scroll_ulc_x;
+      RECT rect = GetClientRect ();
       rect.top =
         header_height + row * row_height -
         scroll_ulc_y;
       rect.bottom = rect.top + row_height;
       InvalidateRect (hwnd, &rect, TRUE);
     }
-#endif
   return 0;
 }
 
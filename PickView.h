@@ -33,6 +33,7 @@
 
 class PickView;
 #include "PickCategoryLine.h"
+#include "IncrementalResolver.h"
 #include "package_meta.h"
 
 class PickView : public Window
@@ -83,6 +84,8 @@ public:
   int scroll_ulc_x, scroll_ulc_y;
   int header_height;
   PickCategoryLine contents;
+  /* the selections clicks change, resolved after each click */
+  IncrementalResolver selections;
   void scroll (HWND hwnd, int which, int *var, int code, int howmany);
 
   void SetPackageFilter (const std::string &filterString)
@@ -134,7 +137,7 @@ private:
                    int addend, int column);
 };
 
-bool isObsolete (std::set <std::string, casecompare_lt_op> &categories);
+bool isObsolete (std::set <pooled_string, casecompare_lt_op> &categories);
 bool isObsolete (const std::string& catname);
 
 #endif /* SETUP_PICKVIEW_H */
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#include "ProviderIndex.h"
+
+#include <algorithm>
+#include "package_meta.h"
+
+ProviderIndex::ProviderIndex (PackageCollection &aCollection) :
+  packages (&aCollection), built (false)
+{
+}
+
+class ByName
+{
+public:
+  bool operator () (ProviderIndex::Provider const &a,
+		    ProviderIndex::Provider const &b) const
+  {
+    return &a.provided->packageName () < &b.provided->packageName ();
+  }
+};
+
+void
+ProviderIndex::build ()
+{
+  providers.clear ();
+  ranges.clear ();
+  for (PackageCollection::id_type id = 0; id < packages->ids (); ++id)
+    {
+      packagemeta *pkg = (*packages)[id];
+      if (!pkg)
+	continue;
+      for (std::set<packageversion>::iterator v = pkg->versions.begin ();
+	   v != pkg->versions.end (); ++v)
+	{
+	  PackageAndList const *provides
+	    = const_cast<packageversion &> (*v).provides ();
+	  for (PackageAndList::const_iterator o = provides->begin ();
+	       o != provides->end (); ++o)
+	    for (PackageOrList::const_iterator s = (*o)->begin ();
+		 s != (*o)->end (); ++s)
+	      {
+		Provider p = { id, *v, *s };
+		providers.push_back (p);
+	      }
+	}
+    }
+  /* stable, to keep each name's providers in id order */
+  std::stable_sort (providers.begin (), providers.end (), ByName ());
+  for (uint32_t i = 0; i < providers.size (); )
+    {
+      const std::string *name = &providers[i].provided->packageName ();
+      uint32_t start = i;
+      while (i < providers.size ()
+	     && &providers[i].provided->packageName () == name)
+	++i;
+      ranges[name] = std::make_pair (start, i);
+    }
+  built = true;
+}
+
+void
+ProviderIndex::clear ()
+{
+  providers.clear ();
+  ranges.clear ();
+  built = false;
+}
+
+ProviderIndex::Provider const *
+ProviderIndex::findSatisfying (PackageSpecification const &spec)
+{
+  range r = find (spec);
+  for (const_iterator p = r.first; p != r.second; ++p)
+    if (spec.satisfiedBy (*p->provided))
+      return &*p;
+  return NULL;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#ifndef SETUP_PROVIDERINDEX_H
+#define SETUP_PROVIDERINDEX_H
+
+/* The Provides: of every package version, by the name provided, so that a
+ * dependency on a virtual name can be met without walking every package.
+ *
+ * Names are looked up by their interned string, which every
+ * PackageSpecification has, so a lookup hashes a pointer rather than a
+ * string.  The providers of a name are kept together, in package id
+ * order, in one vector.
+ *
+ * The index is built from the packages in the collection the first time it
+ * is asked for, which is after setup.ini has been parsed, and again by
+ * build (); it does not notice packages or versions added later.
+ */
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "PackageCollection.h"
+#include "PackageSpecification.h"
+#include "package_version.h"
+
+class ProviderIndex
+{
+public:
+  /* A version providing a name.  provided is its Provides: entry, whose
+     version, if it has one, is the version of the name provided. */
+  struct Provider
+  {
+    PackageCollection::id_type id;
+    packageversion version;
+    PackageSpecification const *provided;
+  };
+  typedef std::vector<Provider>::const_iterator const_iterator;
+  typedef std::pair<const_iterator, const_iterator> range;
+
+  ProviderIndex (PackageCollection &packages);
+
+  /* Index the versions of the packages as they are now. */
+  void build ();
+  /* Forget everything; the next find () builds the index again. */
+  void clear ();
+
+  /* The versions providing the name spec asks for, whatever version of
+     it they provide. */
+  range find (PackageSpecification const &spec)
+  {
+    if (!built)
+      build ();
+    Ranges::const_iterator r = ranges.find (&spec.packageName ());
+    if (r == ranges.end ())
+      return range (providers.end (), providers.end ());
+    return range (providers.begin () + r->second.first,
+		  providers.begin () + r->second.second);
+  }
+  /* The first version providing what spec asks for, or NULL. */
+  Provider const *findSatisfying (PackageSpecification const &spec);
+  bool empty ()
+  {
+    if (!built)
+      build ();
+    return providers.empty ();
+  }
+private:
+  PackageCollection *packages;
+  std::vector<Provider> providers;
+  /* by interned name, where its providers start and end in providers */
+  typedef std::unordered_map<const std::string *, std::pair<uint32_t, uint32_t> >
+    Ranges;
+  Ranges ranges;
+  bool built;
+};
+
+#endif /* SETUP_PROVIDERINDEX_H */
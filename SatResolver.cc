@@ -0,0 +1,468 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#include "SatResolver.h"
+
+#include <algorithm>
+#include "LogSingleton.h"
+#include "package_db.h"
+#include "package_meta.h"
+
+/* The most variables minimise () counts with: a row for each package
+   counted, one wider than the number of them the first model changes. */
+static const size_t maxCounter = 1 << 20;
+
+SatResolver::SatResolver (trusts deftrust) :
+  trust (deftrust), picked (0), nextPreferred (0), nextRequired (0),
+  nextFree (0), changed (0)
+{
+}
+
+/* What would be installed if nothing changed: the version picked or kept,
+   or the installed one if only its source is wanted or an upgrade can't
+   be had, and nothing if it is to be removed. */
+static packageversion
+current (packagemeta *pkg)
+{
+  if (!pkg->desired)
+    return packageversion ();
+  if (pkg->desired.picked () || pkg->desired == pkg->installed)
+    return pkg->desired;
+  return pkg->installed;
+}
+
+/* The trusted version first, then the newest.  Whatever is selected or
+   installed is tried before any of them anyway, so that needn't come into
+   it, and the order holds for as long as the trust does. */
+class VersionPreference
+{
+public:
+  VersionPreference (packageversion const &aTrusted) : trusted (aTrusted) {}
+  bool operator () (packageversion const &a, packageversion const &b) const
+  {
+    if ((a == trusted) != (b == trusted))
+      return a == trusted;
+    return packageversion::compareVersions (a, b) > 0;
+  }
+private:
+  packageversion trusted;
+};
+
+/* A variable for each version of pkg, best first. */
+void
+SatResolver::addVersions (packagemeta *pkg)
+{
+  std::vector<packageversion> sorted (pkg->versions.begin (),
+				      pkg->versions.end ());
+  if (sorted.size () > 1)
+    std::sort (sorted.begin (), sorted.end (),
+	       VersionPreference (pkg->trustp (false, trust)));
+  for (std::vector<packageversion>::iterator i = sorted.begin ();
+       i != sorted.end (); ++i)
+    {
+      newVariable ();
+      versions.push_back (*i);
+      packages.push_back (pkg);
+    }
+}
+
+/* The variable of the version p names. */
+SatSolver::variable
+SatResolver::variableOf (ProviderIndex::Provider const &p) const
+{
+  variable w = firstVariable[p.id];
+  while (w + 1 < firstVariable[p.id + 1] && versions[w] != p.version)
+    ++w;
+  return w;
+}
+
+void
+SatResolver::addProvided (std::vector<literal> &clause,
+			  PackageSpecification const &spec)
+{
+  size_t start = clause.size ();
+  ProviderIndex::range r = packagedb::providers.find (spec);
+  for (ProviderIndex::const_iterator p = r.first; p != r.second; ++p)
+    if (spec.satisfiedBy (*p->provided))
+      clause.push_back (positive (variableOf (*p)));
+  /* by package, and each package's versions best first */
+  std::sort (clause.begin () + start, clause.end ());
+}
+
+void
+SatResolver::addDepends (variable v)
+{
+  DependencyGraph &graph = packagedb::graph;
+  DependencyGraph::index_type node = versions[v].dependencyNode ();
+  std::vector<literal> clause;
+  for (DependencyGraph::index_type c = graph.clauseBegin (node);
+       c != graph.clauseEnd (node); ++c)
+    {
+      clause.assign (1, negative (v));
+      for (DependencyGraph::index_type a = graph.alternativeBegin (c);
+	   a != graph.alternativeEnd (c); ++a)
+	{
+	  PackageSpecification *spec = graph.spec (a);
+	  if (graph.package (a))
+	    {
+	      PackageCollection::id_type id = graph.target (a);
+	      for (variable w = firstVariable[id]; w < firstVariable[id + 1];
+		   ++w)
+		if (spec->satisfiesVersion (versions[w]))
+		  clause.push_back (positive (w));
+	    }
+	  addProvided (clause, *spec);
+	}
+      /* Nothing can meet it; like set_requirements (), go without. */
+      if (clause.size () == 1)
+	continue;
+      requirements.insert (requirements.end (), clause.begin () + 1,
+			   clause.end ());
+      requirements.push_back (noLiteral);
+      addClause (clause);
+    }
+}
+
+void
+SatResolver::addConflicts (variable v, PackageAndList const *list)
+{
+  if (list->empty ())
+    return;
+  std::vector<literal> clause (2, negative (v));
+  for (PackageAndList::const_iterator o = list->begin (); o != list->end ();
+       ++o)
+    for (PackageOrList::const_iterator s = (*o)->begin (); s != (*o)->end ();
+	 ++s)
+      {
+	const std::string& name = (*s)->packageName ();
+	PackageCollection::id_type id = packagedb::packages.id (name);
+	if (id != PackageCollection::npos
+	    && packagedb::packages[id] != packages[v])
+	  for (variable w = firstVariable[id]; w < firstVariable[id + 1]; ++w)
+	    if ((*s)->satisfiesVersion (versions[w]))
+	      {
+		clause[1] = negative (w);
+		addClause (clause);
+	      }
+	ProviderIndex::range r = packagedb::providers.find (**s);
+	for (ProviderIndex::const_iterator p = r.first; p != r.second; ++p)
+	  if (packagedb::packages[p->id] != packages[v]
+	      && (*s)->satisfiedBy (*p->provided))
+	    {
+	      clause[1] = negative (variableOf (*p));
+	      addClause (clause);
+	    }
+      }
+}
+
+/* At most one of the variables from first to end is true.  Pairwise while
+   that takes no more clauses, else with the sequential encoding (Sinz,
+   2005): a new variable for each but the last, true if any of the
+   variables up to it is, in 3n - 4 clauses. */
+void
+SatResolver::atMostOne (variable first, variable end)
+{
+  std::vector<literal> clause (2);
+  if (end - first <= 5)
+    {
+      for (variable a = first; a < end; ++a)
+	for (variable b = a + 1; b < end; ++b)
+	  {
+	    clause[0] = negative (a);
+	    clause[1] = negative (b);
+	    addClause (clause);
+	  }
+      return;
+    }
+  variable before = newVariable ();
+  clause[0] = negative (first);
+  clause[1] = positive (before);
+  addClause (clause);
+  for (variable a = first + 1; a < end; ++a)
+    {
+      clause[0] = negative (a);
+      clause[1] = negative (before);
+      addClause (clause);
+      if (a + 1 == end)
+	break;
+      variable upto = newVariable ();
+      clause[1] = positive (upto);
+      addClause (clause);
+      clause[0] = negative (before);
+      addClause (clause);
+      before = upto;
+    }
+}
+
+void
+SatResolver::encode ()
+{
+  packagedb db;
+  PackageCollection::id_type ids = db.packages.ids ();
+  firstVariable.resize (ids + 1);
+  for (PackageCollection::id_type id = 0; id < ids; ++id)
+    {
+      firstVariable[id] = SatSolver::variables ();
+      if (db.packages[id])
+	addVersions (db.packages[id]);
+    }
+  firstVariable[ids] = SatSolver::variables ();
+
+  requirementStarts.reserve (versions.size () + 1);
+  for (variable v = 0; v < versions.size (); ++v)
+    {
+      requirementStarts.push_back (requirements.size ());
+      addDepends (v);
+      addConflicts (v, versions[v].conflicts ());
+      addConflicts (v, versions[v].replaces ());
+    }
+  requirementStarts.push_back (requirements.size ());
+
+  wanted.resize (ids);
+  std::vector<literal> some;
+  for (PackageCollection::id_type id = 0; id < ids; ++id)
+    {
+      variable first = firstVariable[id], end = firstVariable[id + 1];
+      if (first == end)
+	continue;
+      atMostOne (first, end);
+      /* some version of it, if it is wanted */
+      if (end - first == 1)
+	{
+	  wanted[id] = positive (first);
+	  continue;
+	}
+      variable w = newVariable ();
+      wanted[id] = positive (w);
+      some.assign (1, negative (w));
+      for (variable a = first; a < end; ++a)
+	some.push_back (positive (a));
+      addClause (some);
+    }
+}
+
+/* What to assume and prefer this time: some version of each package
+   picked, and the current versions of the picked and installed packages
+   first. */
+void
+SatResolver::prepare ()
+{
+  packagedb db;
+  assumed.clear ();
+  preferred.clear ();
+  std::vector<variable> kept;
+  for (PackageCollection::id_type id = 0; id + 1 < firstVariable.size ();
+       ++id)
+    {
+      packagemeta *pkg = db.packages[id];
+      packageversion cur = pkg ? current (pkg) : packageversion ();
+      if (!cur)
+	continue;
+      variable v = firstVariable[id], end = firstVariable[id + 1];
+      while (v < end && versions[v] != cur)
+	++v;
+      if (v == end)
+	continue;
+      if (pkg->desired.picked ())
+	{
+	  assumed.push_back (wanted[id]);
+	  preferred.push_back (v);
+	}
+      else
+	kept.push_back (v);
+    }
+  picked = preferred.size ();
+  preferred.insert (preferred.end (), kept.begin (), kept.end ());
+  nextPreferred = nextRequired = nextFree = 0;
+  changed = 0;
+}
+SatSolver::literal
+SatResolver::decide ()
+{
+  /* First what is picked, then what is installed ... */
+  for (; nextPreferred < preferred.size (); ++nextPreferred)
+    if (!truth (positive (preferred[nextPreferred])))
+      return positive (preferred[nextPreferred]);
+
+  /* ... then what the versions to be installed need ... */
+  for (; nextRequired < trail ().size (); ++nextRequired)
+    {
+      literal l = trail ()[nextRequired];
+      /* (not for the encoding's own variables) */
+      if ((l & 1) || var (l) >= versions.size ())
+	continue;
+      uint32_t r = requirementStarts[var (l)];
+      while (r < requirementStarts[var (l) + 1])
+	{
+	  literal best = noLiteral;
+	  bool met = false;
+	  for (; requirements[r] != noLiteral; ++r)
+	    {
+	      int t = truth (requirements[r]);
+	      met |= t > 0;
+	      if (!t && best == noLiteral)
+		best = requirements[r];
+	    }
+	  ++r;
+	  if (!met && best != noLiteral)
+	    return best;
+	}
+    }
+
+  /* ... and nothing else. */
+  for (; nextFree < SatSolver::variables (); ++nextFree)
+    if (!truth (positive (nextFree)))
+      return negative (nextFree);
+  return noLiteral;
+}
+
+void
+SatResolver::backjumped ()
+{
+  nextPreferred = 0;
+  nextRequired = 0;
+  nextFree = 0;
+}
+
+/* Keep the model found, as the best one so far. */
+void
+SatResolver::keep ()
+{
+  model.resize (versions.size ());
+  for (variable v = 0; v < versions.size (); ++v)
+    model[v] = value (v);
+}
+
+/* The number of the preferred versions from begin to end that the model
+   kept leaves out. */
+size_t
+SatResolver::dropped (size_t begin, size_t end) const
+{
+  size_t count = 0;
+  for (size_t i = begin; i < end; ++i)
+    count += !model[preferred[i]];
+  return count;
+}
+
+/* Solve again and again, each time assuming fewer of the preferred
+   versions from begin to end are left out than in the last model, until
+   that can't be done, and then assume that many at most from then on.
+   The number is counted with a sequential counter (Sinz, 2005): a row of
+   variables for each version, the jth true if at least j of the versions
+   up to it are left out.  Returns the fewest found. */
+size_t
+SatResolver::minimise (size_t begin, size_t end)
+{
+  size_t best = dropped (begin, end);
+  std::vector<literal> clause;
+  if (!best || (end - begin) * (best + 1) > maxCounter)
+    {
+      if (best)
+	Log (LOG_BABBLE) << "Not minimising the " << best << " of "
+			 << end - begin << " picked or installed packages "
+			 "changed" << endLog;
+      /* keep at least what is kept now */
+      for (size_t i = begin; i < end; ++i)
+	if (model[preferred[i]])
+	  assumed.push_back (positive (preferred[i]));
+      return best;
+    }
+  std::vector<variable> above, row;
+  for (size_t i = begin; i < end; ++i)
+    {
+      literal out = negative (preferred[i]);
+      row.clear ();
+      for (size_t j = 0; j < std::min (i - begin + 1, best + 1); ++j)
+	{
+	  row.push_back (newVariable ());
+	  if (j < above.size ())
+	    {
+	      clause.assign (1, negative (above[j]));
+	      clause.push_back (positive (row[j]));
+	      addClause (clause);
+	    }
+	  clause.assign (1, out ^ 1);
+	  if (j)
+	    clause.push_back (negative (above[j - 1]));
+	  clause.push_back (positive (row[j]));
+	  addClause (clause);
+	}
+      above.swap (row);
+    }
+  while (best)
+    {
+      assumed.push_back (negative (above[best - 1]));
+      bool fewer = solve (assumed);
+      assumed.pop_back ();
+      if (!fewer)
+	break;
+      keep ();
+      best = dropped (begin, end);
+    }
+  assumed.push_back (negative (above[best]));
+  return best;
+}
+
+void
+SatResolver::apply (std::vector<packagemeta *> *changes)
+{
+  for (variable v = 0; v < versions.size (); )
+    {
+      packagemeta *pkg = packages[v];
+      packageversion chosen;
+      for (; v < versions.size () && packages[v] == pkg; ++v)
+	if (model[v])
+	  chosen = versions[v];
+      if (chosen == current (pkg))
+	continue;
+      ++changed;
+      if (changes)
+	changes->push_back (pkg);
+      if (!chosen)
+	{
+	  pkg->desired = packageversion ();
+	  continue;
+	}
+      /* preserve source */
+      bool sourceticked = pkg->desired.sourcePackage ().picked ();
+      pkg->desired = chosen;
+      pkg->desired.pick (pkg->installed != pkg->desired, pkg);
+      pkg->desired.sourcePackage ().pick (sourceticked, NULL);
+    }
+}
+
+bool
+SatResolver::resolve (std::vector<packagemeta *> *changes)
+{
+  if (firstVariable.empty ())
+    encode ();
+  prepare ();
+  if (!solve (assumed))
+    {
+      Log (LOG_PLAIN) << "The package selections can't all be met: "
+		      << versions.size () << " versions, " << clauses ()
+		      << " clauses, " << conflicts () << " conflicts"
+		      << endLog;
+      return false;
+    }
+  keep ();
+  /* what was picked comes first */
+  minimise (0, picked);
+  size_t dropped = minimise (picked, preferred.size ());
+  apply (changes);
+  Log (LOG_BABBLE) << "Resolved " << versions.size () << " versions, "
+		   << clauses () << " clauses with " << conflicts ()
+		   << " conflicts, changing " << changed << " packages, "
+		   << dropped << " of the installed ones" << endLog;
+  return true;
+}
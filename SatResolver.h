@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#ifndef SETUP_SATRESOLVER_H
+#define SETUP_SATRESOLVER_H
+
+/* Resolves the selections in the package database as a whole, as a SAT
+ * problem, instead of following depends one package at a time the way
+ * packagemeta::set_requirements () does.  This honours Conflicts:,
+ * Replaces: and Provides: as well.
+ *
+ * There is a variable for every version of every package, and clauses
+ * for
+ *   - at most one version of a package (in a sequential encoding, for
+ *     packages with many versions),
+ *   - every depends clause of a version: some alternative that satisfies
+ *     it, a version of the package named or of one that provides the
+ *     name (a clause nothing can satisfy is ignored, as it is by
+ *     set_requirements ()),
+ *   - every package a version conflicts with or replaces, or that
+ *     provides a name it does (see packagedb::providers): not both,
+ *   - every package: some version of it, if it is wanted.
+ * None of which depends on the selections, so the encoding is kept from
+ * one resolve () to the next, for as long as the package database stays
+ * the same; each one assumes what is picked is wanted.
+ *
+ * The search tries the picked versions and then the installed ones first,
+ * and then only installs something when a depends clause asks for it,
+ * going by the order of the alternatives and preferring the version
+ * already selected or installed, then the one trustp () gives.  That
+ * keeps close to what is installed and selected.  Then, as long as the
+ * counter that takes is not too big, it solves again and again, each time
+ * for fewer of the picked packages removed or changed, and then likewise
+ * for the installed ones, so as few of them change as possible, the
+ * picked ones first.  What else is installed is still up to the search.
+ * inilint --bench counts how many each resolver changes.
+ */
+
+#include <vector>
+#include "PackageTrust.h"
+#include "ProviderIndex.h"
+#include "SatSolver.h"
+#include "package_version.h"
+
+class packagemeta;
+
+class SatResolver : private SatSolver
+{
+public:
+  SatResolver (trusts deftrust);
+  /* Change packagemeta::desired to the versions chosen, adding the
+     packages changed to changes if it is not NULL.  Returns false,
+     changing nothing, if the selections can't all be met. */
+  bool resolve (std::vector<packagemeta *> *changes = NULL);
+  trusts defaultTrust () const { return trust; }
+
+  size_t variables () const { return SatSolver::variables (); }
+  size_t clauses () const { return SatSolver::clauses (); }
+  size_t conflicts () const { return SatSolver::conflicts (); }
+  /* the number of packages whose selection resolve () changed */
+  size_t changes () const { return changed; }
+private:
+  virtual literal decide ();
+  virtual void backjumped ();
+
+  void encode ();
+  void prepare ();
+  void atMostOne (variable first, variable end);
+  void addVersions (packagemeta *pkg);
+  void addDepends (variable v);
+  void addConflicts (variable v, PackageAndList const *list);
+  variable variableOf (ProviderIndex::Provider const &p) const;
+  void addProvided (std::vector<literal> &clause,
+		    PackageSpecification const &spec);
+  void keep ();
+  size_t dropped (size_t begin, size_t end) const;
+  size_t minimise (size_t begin, size_t end);
+  void apply (std::vector<packagemeta *> *changes);
+
+  trusts trust;
+  /* by package id: its first variable, and one past its last one */
+  std::vector<variable> firstVariable;
+  /* by variable */
+  std::vector<packageversion> versions;
+  std::vector<packagemeta *> packages;
+  /* by variable, the positions of its depends clauses in requirements,
+     and one past the last variable's */
+  std::vector<uint32_t> requirementStarts;
+  /* the literals of each depends clause, best first, ending with
+     noLiteral */
+  std::vector<literal> requirements;
+  /* by package id, the literal true if some version of it is */
+  std::vector<literal> wanted;
+  /* what the current resolve () assumes */
+  std::vector<literal> assumed;
+  /* the versions to try to install first: what is picked, then what is
+     installed */
+  std::vector<variable> preferred;
+  /* how many of preferred are picked */
+  size_t picked;
+  /* by variable, for each version, the best model found so far */
+  std::vector<bool> model;
+
+  size_t nextPreferred, nextRequired, nextFree;
+  size_t changed;
+};
+
+#endif /* SETUP_SATRESOLVER_H */
@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#include "SatSolver.h"
+
+#include <algorithm>
+
+const SatSolver::literal SatSolver::noLiteral;
+const uint32_t SatSolver::noClause;
+
+SatSolver::SatSolver () :
+  starts (1, 0), propagated (0), nextFree (0), conflictCount (0),
+  inconsistent (false)
+{
+}
+
+SatSolver::variable
+SatSolver::newVariable ()
+{
+  variable v = assigns.size ();
+  assigns.push_back (0);
+  levels.push_back (0);
+  reasons.push_back (noClause);
+  seen.push_back (0);
+  watches.resize (2 * assigns.size ());
+  return v;
+}
+
+void
+SatSolver::addClause (std::vector<literal> clause)
+{
+  cancelAll ();
+  std::sort (clause.begin (), clause.end ());
+  clause.erase (std::unique (clause.begin (), clause.end ()), clause.end ());
+  for (size_t i = 1; i < clause.size (); ++i)
+    if (clause[i] == (clause[i - 1] ^ 1))
+      /* always true */
+      return;
+  /* Only units, and after solve () what they imply, are assigned now, and
+     for good, so a literal that is true makes the clause true, and one
+     that is false can be left out. */
+  size_t kept = 0;
+  for (size_t i = 0; i < clause.size (); ++i)
+    {
+      int t = truth (clause[i]);
+      if (t > 0)
+	return;
+      if (!t)
+	clause[kept++] = clause[i];
+    }
+  clause.resize (kept);
+  if (clause.empty ())
+    inconsistent = true;
+  else if (clause.size () == 1)
+    enqueue (clause[0], noClause);
+  else
+    attach (clause);
+}
+
+uint32_t
+SatSolver::attach (std::vector<literal> const &clause)
+{
+  uint32_t c = starts.size () - 1;
+  literals.insert (literals.end (), clause.begin (), clause.end ());
+  starts.push_back (literals.size ());
+  watches[clause[0]].push_back (c);
+  watches[clause[1]].push_back (c);
+  return c;
+}
+
+void
+SatSolver::enqueue (literal l, uint32_t reason)
+{
+  assigns[var (l)] = (l & 1) ? -1 : 1;
+  levels[var (l)] = levelStarts.size ();
+  reasons[var (l)] = reason;
+  trail_.push_back (l);
+}
+
+/* Make every clause that has only one literal left that isn't false
+   assert it.  Returns a clause all of whose literals are false, if one
+   turns up. */
+uint32_t
+SatSolver::propagate ()
+{
+  while (propagated < trail_.size ())
+    {
+      literal falseLit = trail_[propagated++] ^ 1;
+      std::vector<uint32_t> &ws = watches[falseLit];
+      size_t i = 0, j = 0;
+      while (i < ws.size ())
+	{
+	  uint32_t c = ws[i++];
+	  literal *lits = &literals[starts[c]];
+	  size_t size = starts[c + 1] - starts[c];
+	  /* keep the false literal second */
+	  if (lits[0] == falseLit)
+	    std::swap (lits[0], lits[1]);
+	  if (truth (lits[0]) > 0)
+	    {
+	      ws[j++] = c;
+	      continue;
+	    }
+	  size_t k = 2;
+	  while (k < size && truth (lits[k]) < 0)
+	    ++k;
+	  if (k < size)
+	    {
+	      /* watch another literal instead */
+	      std::swap (lits[1], lits[k]);
+	      watches[lits[1]].push_back (c);
+	      continue;
+	    }
+	  ws[j++] = c;
+	  if (truth (lits[0]) < 0)
+	    {
+	      while (i < ws.size ())
+		ws[j++] = ws[i++];
+	      ws.resize (j);
+	      return c;
+	    }
+	  enqueue (lits[0], c);
+	}
+      ws.resize (j);
+    }
+  return noClause;
+}
+
+/* Learn the first-UIP clause of a conflict, with the literal it asserts
+   first and one from the level to go back to second.  Returns that
+   level. */
+size_t
+SatSolver::analyze (uint32_t conflict, std::vector<literal> &learnt)
+{
+  learnt.assign (1, noLiteral);
+  size_t current = levelStarts.size ();
+  size_t pending = 0, index = trail_.size ();
+  literal p = noLiteral;
+  uint32_t c = conflict;
+  do
+    {
+      /* the first literal of a reason is the one it implied, p */
+      for (uint32_t i = starts[c] + (p == noLiteral ? 0 : 1);
+	   i < starts[c + 1]; ++i)
+	{
+	  variable v = var (literals[i]);
+	  if (seen[v] || !levels[v])
+	    continue;
+	  seen[v] = 1;
+	  if (levels[v] == current)
+	    ++pending;
+	  else
+	    learnt.push_back (literals[i]);
+	}
+      while (!seen[var (trail_[--index])])
+	;
+      p = trail_[index];
+      c = reasons[var (p)];
+      seen[var (p)] = 0;
+    }
+  while (--pending);
+  learnt[0] = p ^ 1;
+
+  size_t level = 0;
+  for (size_t i = 1; i < learnt.size (); ++i)
+    {
+      seen[var (learnt[i])] = 0;
+      if (levels[var (learnt[i])] > level)
+	{
+	  level = levels[var (learnt[i])];
+	  std::swap (learnt[1], learnt[i]);
+	}
+    }
+  return level;
+}
+
+void
+SatSolver::cancelUntil (size_t level)
+{
+  if (levelStarts.size () <= level)
+    return;
+  for (size_t i = levelStarts[level]; i < trail_.size (); ++i)
+    {
+      variable v = var (trail_[i]);
+      assigns[v] = 0;
+      reasons[v] = noClause;
+      nextFree = std::min (nextFree, v);
+    }
+  trail_.resize (levelStarts[level]);
+  levelStarts.resize (level);
+  propagated = trail_.size ();
+}
+
+/* Undo every decision, as a new clause or another solve () needs. */
+void
+SatSolver::cancelAll ()
+{
+  if (levelStarts.empty ())
+    return;
+  cancelUntil (0);
+  backjumped ();
+}
+
+bool
+SatSolver::solve (std::vector<literal> const &assumptions)
+{
+  std::vector<literal> learnt;
+  cancelAll ();
+  if (inconsistent)
+    return false;
+  for (;;)
+    {
+      uint32_t conflict = propagate ();
+      if (conflict != noClause)
+	{
+	  ++conflictCount;
+	  if (levelStarts.empty ())
+	    {
+	      inconsistent = true;
+	      return false;
+	    }
+	  size_t level = analyze (conflict, learnt);
+	  cancelUntil (level);
+	  backjumped ();
+	  enqueue (learnt[0], learnt.size () == 1 ? noClause : attach (learnt));
+	  continue;
+	}
+      /* The assumptions are decided first, one to a level, so what is
+	 learnt holds without them. */
+      literal next = noLiteral;
+      while (next == noLiteral && levelStarts.size () < assumptions.size ())
+	{
+	  literal a = assumptions[levelStarts.size ()];
+	  if (truth (a) < 0)
+	    return false;
+	  if (!truth (a))
+	    next = a;
+	  else
+	    levelStarts.push_back (trail_.size ());
+	}
+      if (next == noLiteral)
+	next = decide ();
+      if (next == noLiteral)
+	return true;
+      levelStarts.push_back (trail_.size ());
+      enqueue (next, noClause);
+    }
+}
+
+SatSolver::literal
+SatSolver::decide ()
+{
+  while (nextFree < assigns.size () && assigns[nextFree])
+    ++nextFree;
+  return nextFree < assigns.size () ? negative (nextFree) : noLiteral;
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#ifndef SETUP_SATSOLVER_H
+#define SETUP_SATSOLVER_H
+
+/* A small conflict driven clause learning SAT solver: unit propagation
+ * with two watched literals, first-UIP conflict analysis and
+ * non-chronological backjumping.
+ *
+ * There is no decision heuristic of its own, and no randomness or
+ * restarts: which literal to try next is left to decide (), so a subclass
+ * can steer the search towards the model it likes best, and the same
+ * problem always gives the same model.
+ *
+ * Variables are numbered from 0; the literals of variable v are 2v (v is
+ * true) and 2v + 1 (v is false).
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+class SatSolver
+{
+public:
+  typedef uint32_t variable;
+  typedef uint32_t literal;
+  static const literal noLiteral = (literal) -1;
+
+  static literal positive (variable v) { return 2 * v; }
+  static literal negative (variable v) { return 2 * v + 1; }
+  static variable var (literal l) { return l >> 1; }
+
+  SatSolver ();
+  virtual ~SatSolver () {}
+
+  variable newVariable ();
+  size_t variables () const { return assigns.size (); }
+  /* Between calls of solve (), this drops the model found; what was
+     learnt is kept. */
+  void addClause (std::vector<literal> clause);
+  size_t clauses () const { return starts.size () - 1; }
+
+  /* Find a model of all the clauses added so far in which assumptions
+     hold too; false if there is none.  Unlike a clause, an assumption
+     only holds for the one call. */
+  bool solve (std::vector<literal> const &assumptions
+	      = std::vector<literal> ());
+  /* The value of v in the model found. */
+  bool value (variable v) const { return assigns[v] > 0; }
+  size_t conflicts () const { return conflictCount; }
+protected:
+  /* The literal to make true next, which must be unassigned, or noLiteral
+     once every variable is assigned.  By default the first unassigned
+     variable is made false. */
+  virtual literal decide ();
+  /* Assignments were undone down to trail ().size () after a conflict. */
+  virtual void backjumped () {}
+
+  /* 1 if l is true, -1 if it is false, 0 if it is unassigned */
+  int truth (literal l) const
+  {
+    int v = assigns[var (l)];
+    return (l & 1) ? -v : v;
+  }
+  /* the literals made true so far, in order */
+  std::vector<literal> const &trail () const { return trail_; }
+private:
+  static const uint32_t noClause = (uint32_t) -1;
+
+  void enqueue (literal l, uint32_t reason);
+  uint32_t propagate ();
+  size_t analyze (uint32_t conflict, std::vector<literal> &learnt);
+  void cancelUntil (size_t level);
+  void cancelAll ();
+  uint32_t attach (std::vector<literal> const &clause);
+
+  /* the clauses' literals one after the other; the first two of a clause
+     of two or more literals are watched */
+  std::vector<literal> literals;
+  /* where each clause starts in literals, and where the last one ends */
+  std::vector<uint32_t> starts;
+  /* the clauses watching each literal, by literal */
+  std::vector<std::vector<uint32_t> > watches;
+
+  /* by variable: 1 true, -1 false, 0 unassigned */
+  std::vector<signed char> assigns;
+  std::vector<uint32_t> levels;
+  std::vector<uint32_t> reasons;
+  std::vector<char> seen;
+  std::vector<literal> trail_;
+  /* where each decision level starts in trail_ */
+  std::vector<size_t> levelStarts;
+  size_t propagated;
+  /* where the default decide () looks next */
+  variable nextFree;
+  size_t conflictCount;
+  bool inconsistent;
+};
+
+#endif /* SETUP_SATSOLVER_H */
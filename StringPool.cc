@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#include "StringPool.h"
+#include <ostream>
+#include <unordered_set>
+
+/* unordered_set never moves its elements, so references into it stay
+   valid.  It's a function static so that names can be interned from
+   static constructors, too. */
+static std::unordered_set<std::string> &
+pool ()
+{
+  static std::unordered_set<std::string> thePool;
+  return thePool;
+}
+
+static unsigned long pool_lookups, pool_saved;
+
+static const std::string&
+do_intern (const std::string& s, bool stored)
+{
+  ++pool_lookups;
+  std::pair<std::unordered_set<std::string>::iterator, bool> i =
+    pool ().insert (s);
+  if (!i.second && stored)
+    pool_saved += sizeof (std::string) + s.size () + 1 - sizeof (void *);
+  return *i.first;
+}
+
+const std::string&
+StringPool::intern (const std::string& s)
+{
+  return do_intern (s, true);
+}
+
+/* Literals are mostly looked up, as in categories.find ("Base"), rather
+   than stored, so they don't count towards the savings. */
+const std::string&
+StringPool::intern (const char *s)
+{
+  return do_intern (std::string (s), false);
+}
+
+const std::string&
+StringPool::empty ()
+{
+  static const std::string &theEmpty = intern (std::string ());
+  return theEmpty;
+}
+
+unsigned long
+StringPool::lookups ()
+{
+  return pool_lookups;
+}
+
+unsigned long
+StringPool::strings ()
+{
+  return pool ().size ();
+}
+
+unsigned long
+StringPool::bytes_saved ()
+{
+  return pool_saved;
+}
+
+std::ostream &
+operator << (std::ostream &os, pooled_string const &s)
+{
+  return os << s.str ();
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#ifndef SETUP_STRINGPOOL_H
+#define SETUP_STRINGPOOL_H
+
+/* The interning table for package, category and dependency names.
+ *
+ * setup.ini repeats the same few thousand names over and over: every
+ * dependency of every version names a package, and every package lists
+ * categories from a set of a few dozen.  intern () keeps one copy of each
+ * distinct string, which lives until the program exits, so that holders
+ * can share it and two interned strings are equal exactly when their
+ * addresses are.
+ *
+ * Only the main thread builds the package database, so there is no
+ * locking.
+ */
+
+#include <string>
+#include <iosfwd>
+
+class StringPool
+{
+public:
+  static const std::string& intern (const std::string& );
+  static const std::string& intern (const char *);
+  /* The interned empty string. */
+  static const std::string& empty ();
+
+  /* How much the pool saved so far, approximately: every lookup that found
+     an existing string saved a std::string and its characters, less the
+     pointer kept instead. */
+  static unsigned long lookups ();
+  static unsigned long strings ();
+  static unsigned long bytes_saved ();
+};
+
+/* An interned string, as cheap to copy and compare as a pointer, that
+   can be used wherever a const std::string & can. */
+class pooled_string
+{
+public:
+  pooled_string () : _s (&StringPool::empty ()) {}
+  pooled_string (const std::string& s) : _s (&StringPool::intern (s)) {}
+  pooled_string (const char *s) : _s (&StringPool::intern (s)) {}
+
+  operator const std::string& () const { return *_s; }
+  const std::string& str () const { return *_s; }
+  const char *c_str () const { return _s->c_str (); }
+  size_t size () const { return _s->size (); }
+
+  bool operator == (pooled_string const &rhs) const { return _s == rhs._s; }
+  bool operator != (pooled_string const &rhs) const { return _s != rhs._s; }
+private:
+  const std::string *_s;
+};
+
+std::ostream &operator << (std::ostream &, pooled_string const &);
+
+#endif /* SETUP_STRINGPOOL_H */
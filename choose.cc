@@ -59,6 +59,7 @@ static const char *cvsid =
 #include "Generic.h"
 #include "ControlAdjuster.h"
 #include "prereq.h"
+#include "SatResolver.h"
 
 #include "UserSettings.h"
 
@@ -68,6 +69,7 @@ static BoolOption CleanOrphansOption (false, 'o', "delete-orphans", "remove orph
 static BoolOption ForceCurrentOption (false, 'f', "force-current", "select the current version for all packages");
 static BoolOption PruneInstallOption (false, 'Y', "prune-install", "prune the installation to only the requested packages");
 static BoolOption MirrorOption (false, 'm', "mirror-mode", "Skip availability check when installing from local directory (requires local directory to be clean mirror!)");
+static BoolOption SatSolverOption (false, 'T', "sat-solver", "Resolve dependencies as a whole, honouring conflicts, replaces and provides");
 
 using namespace std;
 
@@ -146,6 +148,7 @@ ChooserPage::createListview ()
   packagedb::categoriesType::iterator it = db.categories.find("All");
   Category &cat = (it == db.categories.end ()) ? dummy_cat : *it;
   chooser = new PickView (cat);
+  chooser->selections.useSatSolver (SatSolverOption);
   RECT r = getDefaultListViewSize();
   if (!chooser->Create(this, WS_CHILD | WS_HSCROLL | WS_VSCROLL | WS_VISIBLE,&r))
     // TODO throw exception
@@ -380,9 +383,20 @@ ChooserPage::changeTrust(trusts aTrust)
   packagedb db;
   db.markUnVisited ();
 
-  for (packagedb::packagecollection::iterator i = db.packages.begin(); i != db.packages.end(); i++)
+  /* falls back to following the depends of each package in turn if the
+     selections can't all be met */
+  if (!SatSolverOption || !SatResolver (aTrust).resolve ())
     {
-      i->second->set_requirements(aTrust);
+      size_t touched = 0;
+      for (packagedb::packagecollection::iterator i = db.packages.begin(); i != db.packages.end(); i++)
+	{
+	  i->second->set_requirements(aTrust, touched);
+	}
+      size_t cached, checked;
+      packageversion::versionChecksThisPass (cached, checked);
+      Log (LOG_BABBLE) << "Resolving the requirements touched " << touched
+		       << " packages; " << cached << " of " << checked
+		       << " version checks were cached" << endLog;
     }
 
   chooser->refresh();
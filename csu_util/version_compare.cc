@@ -85,10 +85,65 @@ int version_compare (string a, string b)
   return (apos2 < alen ? 1 : -1);
 }
 
+/* The key is the runs of version_compare () one after another, each a
+ * byte saying what it is followed by its value, then a 0 byte:
+ *   1, the characters ('\0' and '\1' escaped as "\1\1" and "\1\2"), 0
+ *     for a run of non-digits, which sort as strings do;
+ *   2, the number of digits, the digits
+ *     for a number, without leading zeros, so longer numbers are greater;
+ *     up to 254 digits the count is one byte, else 255 and four bytes.
+ * Non-digits sort first, and a version sorts before those it is the start
+ * of, as 0 is less than either type byte.
+ */
+string version_key (const string& version)
+{
+  string key;
+  key.reserve (version.size () + 8);
+  size_t pos = 0, len = version.length ();
+  while (pos < len)
+  {
+    size_t start = pos;
+    if (isdigit (version[pos]))
+    {
+      while (pos < len && isdigit (version[pos])) pos++;
+      while (start < pos && version[start] == '0') start++;
+      size_t digits = pos - start;
+      key += '\2';
+      if (digits < 255)
+        key += (char) digits;
+      else
+      {
+        key += '\377';
+        for (int shift = 24; shift >= 0; shift -= 8)
+          key += (char) (digits >> shift);
+      }
+      key.append (version, start, digits);
+    }
+    else
+    {
+      key += '\1';
+      for (; pos < len && !isdigit (version[pos]); pos++)
+        if (version[pos] == '\0' || version[pos] == '\1')
+        {
+          key += '\1';
+          key += version[pos] + 1;
+        }
+        else
+          key += version[pos];
+      key += '\0';
+    }
+  }
+  key += '\0';
+  return key;
+}
+
 #ifdef TESTING_VERSION_COMPARE
 
+#include <chrono>
 #include <iostream>
 #include <iomanip>
+#include <stdlib.h>
+#include <vector>
 using namespace std;
 
 struct version_pair
@@ -110,6 +165,25 @@ static version_pair test_data[] =
   { NULL, NULL }
 };
 
+/* A random version made of the kinds of runs real ones have. */
+static string random_version ()
+{
+  static const char *const runs[] =
+    { "0", "00", "1", "01", "2", "9", "10", "010", "99", "100", "2016",
+      "0000000000000000000000000000001", ".", "-", "_", "+", "~", "a", "b",
+      "ab", "rc", "beta", "git", "A", "\xe9" };
+  string v;
+  for (int n = rand () % 7; n; n--)
+    v += runs[rand () % (sizeof (runs) / sizeof (*runs))];
+  if (rand () % 50 == 0)
+    v += string (300 + rand () % 2, '7');
+  if (rand () % 50 == 0)
+    v += string (1, (char) (rand () % 2));
+  return v;
+}
+
+static int sign (int i) { return (i > 0) - (i < 0); }
+
 int main(int argc, char* argv[])
 {
   version_pair *i = test_data;
@@ -122,7 +196,51 @@ int main(int argc, char* argv[])
     i++;
   }
 
-  return 0;
+  /* version_key () must sort exactly as version_compare () does */
+  srand (argc > 1 ? atoi (argv[1]) : 1);
+  vector<string> versions;
+  for (int n = 0; n < 20000; n++)
+    versions.push_back (random_version ());
+  int failures = 0;
+  for (int n = 0; n < 1000000; n++)
+  {
+    string const &a = versions[rand () % versions.size ()];
+    string const &b = rand () % 8 ? versions[rand () % versions.size ()]
+				  : a + versions[rand () % versions.size ()];
+    if (sign (version_compare (a, b))
+	!= sign (version_key (a).compare (version_key (b))))
+    {
+      if (failures++ < 10)
+	cout << "version_key disagrees on '" << a << "', '" << b << "'"
+	  << endl;
+    }
+  }
+  cout << failures << " disagreements in 1000000 comparisons" << endl;
+
+  /* and how much faster it is to compare keys */
+  vector<string> keys;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now ();
+  for (vector<string>::iterator v = versions.begin (); v != versions.end ();
+       ++v)
+    keys.push_back (version_key (*v));
+  chrono::duration<double> keying = chrono::steady_clock::now () - start;
+  long sum = 0;
+  start = chrono::steady_clock::now ();
+  for (size_t a = 0; a < 1000; a++)
+    for (size_t b = 0; b < versions.size (); b++)
+      sum += version_compare (versions[a], versions[b]);
+  chrono::duration<double> comparing = chrono::steady_clock::now () - start;
+  start = chrono::steady_clock::now ();
+  for (size_t a = 0; a < 1000; a++)
+    for (size_t b = 0; b < keys.size (); b++)
+      sum -= sign (keys[a].compare (keys[b]));
+  chrono::duration<double> keyed = chrono::steady_clock::now () - start;
+  cout << 1000 * versions.size () << " comparisons: version_compare "
+    << comparing.count () * 1000 << " ms, keys " << keyed.count () * 1000
+    << " ms (making " << keys.size () << " keys took "
+    << keying.count () * 1000 << " ms)" << endl;
+
+  return failures || sum ? 1 : 0;
 }
 
 #endif
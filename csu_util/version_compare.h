@@ -27,5 +27,13 @@
  * Inspired but not equivalent to rpmvercmp().
  */
 int version_compare (std::string a, std::string b);
+
+/* A key for version that sorts as version does: version_compare (a, b)
+ * has the sign of a bytewise (memcmp) comparison of version_key (a) and
+ * version_key (b), and the keys of versions it finds equal are equal.
+ * A key is never a prefix of another, so keys can be concatenated to
+ * compare several versions in turn.
+ */
+std::string version_key (const std::string& version);
     
 #endif /* SETUP_VERSION_COMPARE_H */
@@ -105,6 +105,7 @@ cygpackage::setCanonicalVersion (const std::string& version)
       packagev = "0";
       vendor = version;
     }
+  versionKey = packageversion::canonicalVersionKey (canonical);
 }
 
 cygpackage::~cygpackage ()
@@ -183,14 +184,30 @@ cygpackage::Canonical_version ()
   return canonical;
 }
 
+/* The same text is often set again, e.g. by each mirror; the copy already
+   held is kept then. */
 void
 cygpackage::set_sdesc (const std::string& desc)
+{
+  if (!sdesc.same (desc))
+    sdesc = DescriptionText (desc);
+}
+
+void
+cygpackage::set_sdesc (DescriptionText const &desc)
 {
   sdesc = desc;
 }
 
 void
 cygpackage::set_ldesc (const std::string& desc)
+{
+  if (!ldesc.same (desc))
+    ldesc = DescriptionText (desc);
+}
+
+void
+cygpackage::set_ldesc (DescriptionText const &desc)
 {
   ldesc = desc;
 }
@@ -24,6 +24,7 @@
 #include "win32.h" 
 
 #include "package_version.h"
+#include "DescriptionText.h"
 
 class io_stream;
 
@@ -43,14 +44,16 @@ public:
     return type;
   };
   virtual void set_sdesc (const std::string& );
+  virtual void set_sdesc (DescriptionText const &);
   virtual void set_ldesc (const std::string& );
+  virtual void set_ldesc (DescriptionText const &);
   virtual const std::string SDesc ()
   {
-    return sdesc;
+    return sdesc.str ();
   };
   virtual const std::string LDesc ()
   {
-    return ldesc;
+    return ldesc.str ();
   };
   virtual void uninstall ();
 
@@ -82,7 +85,7 @@ private:
   std::string vendor;
   std::string packagev;
   std::string canonical;
-  std::string sdesc, ldesc;
+  DescriptionText sdesc, ldesc;
   char getfilenamebuffer[CYG_PATH_MAX];
 
 //  package_stability_t stability;
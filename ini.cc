@@ -28,6 +28,7 @@
 #include "LogFile.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <stdlib.h>
 #include <stdarg.h>
 #include <process.h>
@@ -43,15 +44,21 @@
 
 #include "io_stream.h"
 #include "io_stream_memory.h"
+#include "io_stream_tee.h"
 
 #include "threebar.h"
 
 #include "getopt++/BoolOption.h"
 #include "IniDBBuilderPackage.h"
+#include "IniDBSnapshot.h"
+#include "IniDelta.h"
 #include "compress.h"
 #include "Exception.h"
 #include "crypto.h"
 #include "package_db.h"
+#include "String++.h"
+#include "StringPool.h"
+#include "DescriptionText.h"
 
 extern ThreeBarProgressPage Progress;
 
@@ -62,10 +69,15 @@ IniList setup_ext_list (setup_exts,
 			setup_exts + (sizeof(setup_exts) / sizeof(*setup_exts)));
 
 static BoolOption NoVerifyOption (false, 'X', "no-verify", "Don't verify setup.ini signatures");
+static BoolOption LazyDescriptionsOption (false, 'E', "lazy-descriptions", "Keep the package database snapshot in memory and show package descriptions from it, instead of copying them");
 
-extern int yyparse ();
-
-/*extern int yydebug;*/
+/* get_url_to_membuf shows its progress through statics, and may ask for a
+   password through NetIO's, and verify_ini_file_sig keeps its keys in
+   statics (fetching more through get_url_to_membuf), so the per-mirror
+   threads below take turns fetching and checking files.  What they do in
+   between, rebuilding a setup.ini from its delta, and the parsing after
+   are still done in parallel. */
+static CRITICAL_SECTION fetch_lock;
 
 class GuiParseFeedback : public IniParseFeedback
 {
@@ -122,52 +134,42 @@ private:
   unsigned int lastpct;
 };
 
-static io_stream*
-decompress_ini (io_stream *ini_file)
+/* Set up the stream a setup file is parsed from: it decompresses ini_file
+   as it is read and, if cache is given, saves a copy of what it reads to
+   cache.new on the way.  Which decompressor to use is determined by file
+   magic.  Progress is reported in compressed bytes consumed, as that is
+   the only size known up front.  The returned stream owns ini_file. */
+static io_stream_tee *
+stream_ini (io_stream *ini_file, const std::string& cache)
 {
-  // Replace the current compressed setup stream with its decompressed
-  // version.  Which decompressor to use is determined by file magic.
-  io_stream *compressed_stream = compress::decompress (ini_file);
-  if (!compressed_stream)
+  io_stream *decompressed = compress::decompress (ini_file);
+  if (!decompressed)
+    /* This isn't a known compression format or an uncompressed file
+       stream.  Pass it on in case it was uncompressed, it will
+       generate a parser error if it was some unknown format. */
+    decompressed = ini_file;
+  io_stream *copy = NULL;
+  if (cache.size ())
     {
-      /* This isn't a known compression format or an uncompressed file
-	 stream.  Pass it on in case it was uncompressed, it will
-	 generate a parser error if it was some unknown format. */
-      delete compressed_stream;
+      io_stream::mkpath_p (PATH_TO_FILE, cache, 0);
+      copy = io_stream::open (cache + ".new", "wb", 0);
     }
-  else
+  return new io_stream_tee (decompressed, copy, ini_file);
+}
+
+/* Keep the copy of a setup file saved by stream_ini () if it was read
+   completely and parsed without errors, and the previous one otherwise. */
+static void
+save_ini (io_stream_tee *ini, const std::string& cache, bool good)
+{
+  std::string tmp = cache + ".new";
+  if (ini->close_copy () == 0 && good)
     {
-      /* Decompress the entire file in memory.  This has the advantage
-	 that input_stream->get_size () will work during parsing and
-	 we'll have an accurate status bar.  Also, we can't seek
-	 compressed streams, so when we write out a local cached copy
-	 of the .ini file below, we'd otherwise have to delete this
-	 stream and uncompress it again from the start, which is
-	 wasteful.  The current uncompressed size of the setup.ini
-	 file as of 2015 is about 5 MiB, so this is not a great deal
-	 of memory.  */
-      io_stream *uncompressed = new io_stream_memory ();
-      /* Note that the decompress io_stream now "owns" the underlying
-	 compressed io_stream instance, so it need not be deleted
-	 explicitly. */
-      if ((io_stream::copy (compressed_stream, uncompressed) != 0) ||
-	  (compressed_stream->error () != 0))
-	{
-	  /* There was a problem decompressing compressed_stream.  */
-	  Log (LOG_PLAIN) <<
-	    "Warning: Error code " << compressed_stream->error () <<
-	    " occurred while uncompressing " << current_ini_name <<
-	    " - possibly truncated or corrupt file. " << endLog;
-	  delete uncompressed;
-	  ini_file = NULL;
-	}
-      else
-	{
-	  ini_file = uncompressed;
-	  ini_file->seek (0, IO_SEEK_SET);
-	}
+      io_stream::remove (cache);
+      if (io_stream::move (tmp, cache) == 0)
+	return;
     }
-  return ini_file;
+  io_stream::remove (tmp);
 }
 
 static io_stream*
@@ -205,12 +207,310 @@ check_ini_sig (io_stream* ini_file, io_stream* ini_sig_file,
   return ini_file;
 }
 
+/* A signature-checked, still compressed setup file waiting to be parsed. */
+struct ini_source
+{
+  std::string name;	/* filename or URL, for messages */
+  std::string site;	/* for "setup file missing" notes */
+  std::string mirror;	/* becomes IniDBBuilder::parse_mirror */
+  std::string cache;	/* where to save a known-good copy, if anywhere */
+  io_stream *ini;
+  /* Set if ini was rebuilt from the cached copy by a setup.ini.delta: */
+  bool patched;
+  unsigned char base[SHA512_DIGEST_LENGTH];	/* digest of the cached copy */
+  unsigned char digest[SHA512_DIGEST_LENGTH];	/* digest of ini */
+  std::vector<std::string> order;	/* the packages of ini */
+  std::string changes;	/* its header and changed stanzas, see IniDelta.h */
+  ini_source () : ini (NULL), patched (false) {}
+};
+typedef std::vector<ini_source> IniSourceList;
+
+/* Save a copy of the setup file of src, which is consumed, the way parsing
+   it would have. */
+static void
+cache_ini (ini_source &src)
+{
+  io_stream_tee *ini = stream_ini (src.ini, src.cache);
+  char buffer[64 * 1024];
+  while (ini->read (buffer, sizeof (buffer)) > 0)
+    ;
+  save_ini (ini, src.cache, !ini->error ());
+  delete ini;
+  src.ini = NULL;
+}
+
+static void
+note_ini_timestamp (IniDBBuilder const &aBuilder)
+{
+  if (aBuilder.timestamp > setup_timestamp)
+    {
+      setup_timestamp = aBuilder.timestamp;
+      ini_setup_version = aBuilder.version;
+    }
+}
+
+static std::string
+snapshot_url ()
+{
+  return "file://" + local_dir + "/" + SetupIniDir + SetupBaseName
+	 + ".snapshot";
+}
+
+/* Start fn on each of jobs, each on a thread of its own.  A job no thread
+   could be created for is run right away instead. */
+template <class J> static std::vector<HANDLE>
+start_threads (std::vector<J> &jobs, LPTHREAD_START_ROUTINE fn)
+{
+  std::vector<HANDLE> threads;
+  for (typename std::vector<J>::iterator i = jobs.begin ();
+       i != jobs.end (); ++i)
+    {
+      DWORD threadID;
+      HANDLE h = CreateThread (NULL, 0, fn, &*i, 0, &threadID);
+      if (h)
+	threads.push_back (h);
+      else
+	fn (&*i);
+    }
+  return threads;
+}
+
+/* Wait up to timeout ms for each of threads to finish, dropping those that
+   did.  Returns true once none are left. */
+static bool
+wait_threads (std::vector<HANDLE> &threads, DWORD timeout)
+{
+  while (!threads.empty ())
+    {
+      if (WaitForSingleObject (threads.back (), timeout) == WAIT_TIMEOUT)
+	return false;
+      CloseHandle (threads.back ());
+      threads.pop_back ();
+    }
+  return true;
+}
+
+/* Remembers how far a parser thread has got, for the main thread to show. */
+class ThreadParseFeedback : public IniParseFeedback
+{
+public:
+  ThreadParseFeedback (unsigned long size) : pos (0), max (size) {}
+  virtual void progress (unsigned long const aPos, unsigned long const aMax)
+    {
+      pos = aPos;
+      max = aMax;
+    }
+  volatile unsigned long pos, max;
+};
+
+/* Parsing one setup file into a package set of its own: the builder calls
+   the parser made, to be applied to the real package database later. */
+struct ini_parse_job
+{
+  ini_parse_job (ini_source &aSource) :
+    src (&aSource), ini (stream_ini (aSource.ini, aSource.cache)),
+    feedback (aSource.ini->get_size ()), errors (0), patched (false) {}
+  ini_source *src;
+  io_stream_tee *ini;
+  ThreadParseFeedback feedback;
+  IniDBSnapshotRecorder packages;
+  int errors;
+  std::string messages;
+  bool patched;		/* packages were patched up, no need to parse */
+};
+
+static DWORD WINAPI
+parse_ini_thread (void *p)
+{
+  ini_parse_job *job = (ini_parse_job *) p;
+  if (job->patched)
+    return 0;
+  try
+  {
+    IniParser parser (job->packages, job->feedback);
+    job->packages.beginIni (job->src->mirror);
+    job->errors = parser.parse (job->ini, job->src->name);
+    job->messages = parser.errors ();
+    if (!job->errors)
+      {
+	unsigned char digest[SHA512_DIGEST_LENGTH];
+	job->ini->digest (digest);
+	job->packages.endIni (digest);
+      }
+  }
+  TOPLEVEL_CATCH ("ini");
+  return 0;
+}
+
+/* Record the packages of a setup file rebuilt by a setup.ini.delta by
+   parsing just the changed stanzas and splicing them into the recording of
+   the file it was built from, as kept in the package database snapshot.
+   The file itself is still read through once, for its saved copy. */
+static bool
+patch_ini (ini_parse_job &job)
+{
+  io_stream_memory changes;
+  changes.write (job.src->changes.data (), job.src->changes.size ());
+  changes.seek (0, IO_SEEK_SET);
+  IniDBSnapshotRecorder changed;
+  IniParser parser (changed, job.feedback);
+  changed.beginIni (job.src->mirror);
+  if (parser.parse (&changes, job.src->name))
+    return false;
+  changed.endIni (job.src->digest);
+  if (!IniDBSnapshot::patch (snapshot_url (), job.src->mirror, job.src->base,
+			     changed, job.src->order, job.src->digest,
+			     job.packages))
+    return false;
+
+  char buffer[64 * 1024];
+  while (job.ini->read (buffer, sizeof (buffer)) > 0)
+    ;
+  return true;
+}
+
+/* Build the package database from all setup files in inis, which are
+   consumed.  If the package database snapshot was made from exactly these
+   files it is replayed instead of parsing them again.
+
+   Otherwise the files are parsed in parallel, one thread each, straight
+   from their decompressors; a copy of each is saved on the way.  The
+   resulting package sets are then merged into the database
+   one after another in the order of inis.  Files rebuilt by a
+   setup.ini.delta are patched into their old package sets where the
+   snapshot still has them.  Merging applies the same
+   builder calls in the same order as parsing the files one by one would,
+   so add_correct_version () sees exactly what it always did and the result
+   doesn't depend on which thread finished first. */
 static int
-do_local_ini (HWND owner)
+parse_ini_list (IniSourceList &inis, HWND owner)
 {
   size_t ini_count = 0;
   GuiParseFeedback myFeedback;
   IniDBBuilderPackage aBuilder (myFeedback);
+
+  IniDBSnapshot key;
+  for (IniSourceList::iterator i = inis.begin (); i != inis.end (); ++i)
+    key.addIni (i->mirror, i->ini);
+  unsigned char digest[SHA512_DIGEST_LENGTH];
+  key.digest (digest);
+
+  DWORD start = GetTickCount ();
+  int replayed = IniDBSnapshot::load (snapshot_url (), digest, aBuilder,
+				      note_ini_timestamp);
+  if (replayed > 0)
+    {
+      Log (LOG_BABBLE) << "Loaded package database snapshot of " << replayed
+		       << " setup files in " << GetTickCount () - start
+		       << " ms" << endLog;
+      /* The cached copies are still brought up to date, or the next
+	 setup.ini.delta would be applied to an old one. */
+      for (IniSourceList::iterator i = inis.begin (); i != inis.end (); ++i)
+	if (i->cache.size ())
+	  cache_ini (*i);
+	else
+	  delete i->ini;
+      inis.clear ();
+      return replayed;
+    }
+
+  myFeedback.iniName (inis.size () == 1 ? inis.front ().name
+		      : stringify (inis.size ()) + " setup files");
+  std::vector<ini_parse_job> jobs;
+  for (IniSourceList::iterator i = inis.begin (); i != inis.end (); ++i)
+    {
+      jobs.push_back (ini_parse_job (*i));
+      i->ini = NULL;	/* now owned by the job's stream */
+    }
+  for (std::vector<ini_parse_job>::iterator j = jobs.begin ();
+       j != jobs.end (); ++j)
+    if (j->src->patched)
+      {
+	j->patched = patch_ini (*j);
+	Log (LOG_BABBLE) << (j->patched ? "Patched package database snapshot"
+			     " for " : "Unable to patch package database"
+			     " snapshot, parsing all of ")
+			 << j->src->name << endLog;
+      }
+  std::vector<HANDLE> threads = start_threads (jobs, parse_ini_thread);
+  while (!wait_threads (threads, 100))
+    {
+      unsigned long pos = 0, max = 0;
+      for (std::vector<ini_parse_job>::iterator j = jobs.begin ();
+	   j != jobs.end (); ++j)
+	{
+	  pos += j->feedback.pos;
+	  max += j->feedback.max;
+	}
+      myFeedback.progress (pos, max);
+    }
+  DWORD parsed = GetTickCount ();
+
+  IniDBSnapshotRecorder recorder (aBuilder);
+  bool complete = true;
+  for (std::vector<ini_parse_job>::iterator j = jobs.begin ();
+       j != jobs.end (); ++j)
+    {
+      if (int err = j->ini->error ())
+	{
+	  /* There was a problem decompressing the file; whatever was parsed
+	     before that is dropped.  */
+	  Log (LOG_PLAIN) <<
+	    "Warning: Error code " << err <<
+	    " occurred while uncompressing " << j->src->name <<
+	    " - possibly truncated or corrupt file. " << endLog;
+	  if (j->src->cache.size ())
+	    save_ini (j->ini, j->src->cache, false);
+	  delete j->ini;
+	  note (owner, IDS_SETUPINI_MISSING, SetupBaseName.c_str (),
+		j->src->site.c_str ());
+	  complete = false;
+	  continue;
+	}
+
+      myFeedback.babble ("Found ini file - " + j->src->name);
+      IniDBSnapshot::replay (j->packages, aBuilder);
+      recorder.append (j->packages);
+      if (j->errors)
+	{
+	  myFeedback.error (j->messages);
+	  complete = false;
+	}
+      else
+	++ini_count;
+      /* keep a known-good setup.ini locally */
+      if (j->src->cache.size ())
+	save_ini (j->ini, j->src->cache, !j->errors);
+      note_ini_timestamp (aBuilder);
+      delete j->ini;
+    }
+  inis.clear ();
+  Log (LOG_BABBLE) << "Parsed " << ini_count << " setup files in "
+		   << parsed - start << " ms, merged them in "
+		   << GetTickCount () - parsed << " ms" << endLog;
+
+  /* Only a database built from every setup file without errors is worth
+     keeping. */
+  if (complete && ini_count
+      && IniDBSnapshot::save (snapshot_url (), digest, recorder))
+    Log (LOG_BABBLE) << "Unable to write package database snapshot "
+		     << snapshot_url () << endLog;
+  return ini_count;
+}
+
+int
+load_ini_snapshot ()
+{
+  IniParseFeedback feedback;
+  IniDBBuilderPackage aBuilder (feedback);
+  return IniDBSnapshot::load (snapshot_url (), NULL, aBuilder,
+			      note_ini_timestamp);
+}
+
+static int
+do_local_ini (HWND owner)
+{
+  IniSourceList inis;
   io_stream *ini_file, *ini_sig_file;
   // iterate over all setup files found in do_from_local_dir
   for (IniList::const_iterator n = found_ini_list.begin ();
@@ -226,8 +526,6 @@ do_local_ini (HWND owner)
       ini_file = io_stream::open ("file://" + current_ini_name, "rb", 0);
       ini_file = check_ini_sig (ini_file, ini_sig_file, sig_fail,
 				"localdir", current_ini_sig_name.c_str (), owner);
-      if (ini_file)
-	ini_file = decompress_ini (ini_file);
       if (!ini_file || sig_fail)
 	{
 	  // no setup found or signature invalid
@@ -236,117 +534,196 @@ do_local_ini (HWND owner)
 	}
       else
 	{
-	  // grok information from setup
-	  myFeedback.babble ("Found ini file - " + current_ini_name);
-	  myFeedback.iniName (current_ini_name);
 	  int ldl = local_dir.length () + 1;
 	  int cap = current_ini_name.rfind ("/" + SetupArch);
-	  aBuilder.parse_mirror =
+	  ini_source src;
+	  src.name = current_ini_name;
+	  src.site = "localdir";
+	  src.mirror =
 	    rfc1738_unescape (current_ini_name.substr (ldl, cap - ldl));
-	  ini_init (ini_file, &aBuilder, myFeedback);
+	  src.ini = ini_file;
+	  inis.push_back (src);
+	}
+    }
+  return parse_ini_list (inis, owner);
+}
 
-	  /*yydebug = 1; */
+/* Where the known-good copy of the setup file of the mirror at url is kept. */
+static std::string
+ini_cache_name (const std::string& url)
+{
+  return "file://" + local_dir + "/" + rfc1738_escape_part (url) + "/"
+	 + SetupIniDir + SetupBaseName + ".ini";
+}
 
-	  if (yyparse () || yyerror_count > 0)
-	    myFeedback.error (yyerror_messages);
-	  else
-	    ++ini_count;
+static std::string
+read_all (io_stream *s)
+{
+  std::string text;
+  char buffer[64 * 1024];
+  ssize_t count;
+  while ((count = s->read (buffer, sizeof (buffer))) > 0)
+    text.append (buffer, count);
+  return text;
+}
 
-	  if (aBuilder.timestamp > setup_timestamp)
-	    {
-	      setup_timestamp = aBuilder.timestamp;
-	      ini_setup_version = aBuilder.version;
-	    }
-	  delete ini_file;
-	  ini_file = NULL;
+/* Fetching and checking the setup file of one mirror. */
+struct ini_fetch_job
+{
+  ini_fetch_job (const std::string& aUrl, HWND anOwner) :
+    url (aUrl), owner (anOwner), sig_fail (false) {}
+  std::string url;
+  HWND owner;
+  ini_source src;
+  bool sig_fail;
+};
+
+/* Try to bring the cached copy of the mirror's setup.ini up to date with
+   the mirror's setup.ini.delta and check the result against setup.ini.sig.
+   Returns false if there is no cached copy or delta, the delta doesn't
+   apply or the signature doesn't match; the whole file is fetched then. */
+static bool
+fetch_ini_delta (ini_fetch_job *job)
+{
+  io_stream *cached = io_stream::open (job->src.cache, "rb", 0);
+  if (!cached)
+    return false;
+  std::string base = read_all (cached);
+  delete cached;
+
+  std::string name = job->url + SetupIniDir + SetupBaseName + ".ini";
+  EnterCriticalSection (&fetch_lock);
+  io_stream *delta_file = get_url_to_membuf (name + ".delta", job->owner);
+  LeaveCriticalSection (&fetch_lock);
+  if (!delta_file)
+    return false;
+  IniDelta delta;
+  bool parsed = delta.parse (read_all (delta_file));
+  delete delta_file;
+  if (!parsed)
+    {
+      Log (LOG_PLAIN) << "Unable to read " << name << ".delta" << endLog;
+      return false;
+    }
+
+  unsigned char have[SHA512_DIGEST_LENGTH];
+  IniDelta::digest (base, have);
+  std::string text;
+  if (!memcmp (have, delta.result_digest, SHA512_DIGEST_LENGTH))
+    /* the cached copy is current */
+    text.swap (base);
+  else if (delta.apply (base, text, job->src.order, job->src.changes))
+    {
+      job->src.patched = true;
+      memcpy (job->src.base, have, SHA512_DIGEST_LENGTH);
+    }
+  else
+    {
+      Log (LOG_BABBLE) << name << ".delta doesn't apply to "
+		       << job->src.cache << endLog;
+      return false;
+    }
+  memcpy (job->src.digest, delta.result_digest, SHA512_DIGEST_LENGTH);
+
+  io_stream *ini = new io_stream_memory;
+  ini->write (text.data (), text.size ());
+  ini->seek (0, IO_SEEK_SET);
+  if (!NoVerifyOption)
+    {
+      EnterCriticalSection (&fetch_lock);
+      io_stream *sig = get_url_to_membuf (name + ".sig", job->owner);
+      bool good = sig && verify_ini_file_sig (ini, sig, job->owner);
+      LeaveCriticalSection (&fetch_lock);
+      delete sig;
+      if (!good)
+	{
+	  Log (LOG_PLAIN) << "Signature check of " << name << " as rebuilt "
+			  "from its delta failed, fetching it in full"
+			  << endLog;
+	  delete ini;
+	  job->src.patched = false;
+	  return false;
 	}
+      ini->seek (0, IO_SEEK_SET);
     }
-  return ini_count;
+  Log (LOG_BABBLE) << (job->src.patched ? "Rebuilt " : "Reusing cached ")
+		   << name << " from " << job->src.cache << endLog;
+  job->src.name = name;
+  job->src.ini = ini;
+  return true;
 }
 
+static DWORD WINAPI
+fetch_ini_thread (void *p)
+{
+  ini_fetch_job *job = (ini_fetch_job *) p;
+  try
+  {
+    if (fetch_ini_delta (job))
+      return 0;
+    // iterate over known extensions for setup
+    for (IniList::const_iterator ext = setup_ext_list.begin ();
+	 ext != setup_ext_list.end ();
+	 ext++)
+      {
+	job->src.name = job->url + SetupIniDir + SetupBaseName + "." + *ext;
+	std::string sig_name = job->src.name + ".sig";
+	EnterCriticalSection (&fetch_lock);
+	io_stream *ini_sig_file = get_url_to_membuf (sig_name, job->owner);
+	io_stream *ini_file = get_url_to_membuf (job->src.name, job->owner);
+	job->src.ini = check_ini_sig (ini_file, ini_sig_file, job->sig_fail,
+				      job->url.c_str (), sig_name.c_str (),
+				      job->owner);
+	LeaveCriticalSection (&fetch_lock);
+	// stop searching as soon as we find a setup file
+	if (job->src.ini)
+	  break;
+      }
+  }
+  TOPLEVEL_CATCH ("ini");
+  return 0;
+}
+
+/* Fetch and check the setup files of all mirrors, one thread each, taking
+   turns at fetching, then parse them.  Where a mirror offers a
+   setup.ini.delta against the copy kept from last time, only that is
+   fetched. */
 static int
 do_remote_ini (HWND owner)
 {
-  size_t ini_count = 0;
-  GuiParseFeedback myFeedback;
-  IniDBBuilderPackage aBuilder (myFeedback);
-  io_stream *ini_file = NULL, *ini_sig_file;
-
-  /* FIXME: Get rid of this io_stream pointer travesty.  The need to
-     explicitly delete these things is ridiculous. */
-
-  // iterate over all sites
+  std::vector<ini_fetch_job> jobs;
   for (SiteList::const_iterator n = site_list.begin ();
        n != site_list.end (); ++n)
     {
-      bool sig_fail = false;
-      std::string current_ini_ext, current_ini_name, current_ini_sig_name;
-      // iterate over known extensions for setup
-      for (IniList::const_iterator ext = setup_ext_list.begin ();
-	   ext != setup_ext_list.end ();
-	   ext++)
-	{
-	  current_ini_ext = *ext;
-	  current_ini_name = n->url + SetupIniDir + SetupBaseName + "." + current_ini_ext;
-	  current_ini_sig_name = current_ini_name + ".sig";
-	  ini_sig_file = get_url_to_membuf (current_ini_sig_name, owner);
-	  ini_file = get_url_to_membuf (current_ini_name, owner);
-	  ini_file = check_ini_sig (ini_file, ini_sig_file, sig_fail,
-				    n->url.c_str (), current_ini_sig_name.c_str (), owner);
-	  // stop searching as soon as we find a setup file
-	  if (ini_file)
-	    break;
-	}
-      if (ini_file)
-	ini_file = decompress_ini (ini_file);
-      if (!ini_file || sig_fail)
+      jobs.push_back (ini_fetch_job (n->url, owner));
+      jobs.back ().src.site = n->url;
+      jobs.back ().src.mirror = n->url;
+      jobs.back ().src.cache = ini_cache_name (n->url);
+    }
+  std::vector<HANDLE> threads = start_threads (jobs, fetch_ini_thread);
+  wait_threads (threads, INFINITE);
+
+  IniSourceList inis;
+  for (std::vector<ini_fetch_job>::iterator j = jobs.begin ();
+       j != jobs.end (); ++j)
+    {
+      if (!j->src.ini || j->sig_fail)
 	{
 	  // no setup found or signature invalid
-	  note (owner, IDS_SETUPINI_MISSING, SetupBaseName.c_str (), n->url.c_str ());
+	  note (owner, IDS_SETUPINI_MISSING, SetupBaseName.c_str (),
+		j->url.c_str ());
 	}
       else
-	{
-	  // grok information from setup
-	  myFeedback.iniName (current_ini_name);
-	  aBuilder.parse_mirror = n->url;
-	  ini_init (ini_file, &aBuilder, myFeedback);
-
-	  /*yydebug = 1; */
-
-	  if (yyparse () || yyerror_count > 0)
-	    myFeedback.error (yyerror_messages);
-	  else
-	    {
-	      /* save known-good setup.ini locally */
-	      const std::string fp = "file://" + local_dir + "/" +
-				      rfc1738_escape_part (n->url) +
-				      "/" + SetupIniDir + SetupBaseName + ".ini";
-	      io_stream::mkpath_p (PATH_TO_FILE, fp, 0);
-	      if (io_stream *out = io_stream::open (fp, "wb", 0))
-		{
-		  ini_file->seek (0, IO_SEEK_SET);
-		  if (io_stream::copy (ini_file, out) != 0)
-		    io_stream::remove (fp);
-		  delete out;
-		}
-	      ++ini_count;
-	    }
-	  if (aBuilder.timestamp > setup_timestamp)
-	    {
-	      setup_timestamp = aBuilder.timestamp;
-	      ini_setup_version = aBuilder.version;
-	    }
-	  delete ini_file;
-	  ini_file = NULL;
-	}
+	inis.push_back (j->src);
     }
-  return ini_count;
+  return parse_ini_list (inis, owner);
 }
 
 static bool
 do_ini_thread (HINSTANCE h, HWND owner)
 {
   size_t ini_count = 0;
+  DescriptionText::lazy = LazyDescriptionsOption;
   if (source == IDC_SOURCE_LOCALDIR)
     ini_count = do_local_ini (owner);
   else
@@ -354,6 +731,12 @@ do_ini_thread (HINSTANCE h, HWND owner)
 
   packagedb db;
   db.upgrade();
+  Log (LOG_BABBLE) << "Interned " << StringPool::strings ()
+		   << " distinct names in " << StringPool::lookups ()
+		   << " lookups, saving about "
+		   << StringPool::bytes_saved () / 1024 << " KiB" << endLog;
+  Log (LOG_BABBLE) << "Package descriptions take "
+		   << DescriptionText::retained () / 1024 << " KiB" << endLog;
 
   if (ini_count == 0)
     return false;
@@ -430,6 +813,13 @@ static HANDLE context[2];
 void
 do_ini (HINSTANCE h, HWND owner)
 {
+  static bool fetch_lock_initialized;
+  if (!fetch_lock_initialized)
+    {
+      InitializeCriticalSection (&fetch_lock);
+      fetch_lock_initialized = true;
+    }
+
   context[0] = h;
   context[1] = owner;
 
@@ -32,8 +32,55 @@ extern std::string SetupBaseName;
 class IniState;
 class IniDBBuilder;
 class IniParseFeedback;
-void ini_init (io_stream *, IniDBBuilder *, IniParseFeedback &);
-#define YYSTYPE char *
+extern const char *ini_lexer_name;	/* "flex" or "iniscan" */
+
+/* Build the package database from the snapshot the last run left in the
+   local package directory, without looking for the setup files it was
+   made from.  Returns how many it had, or 0 if there is no snapshot. */
+int load_ini_snapshot ();
+
+/* The value of a STRING, EMAIL or STRTOEOL token is its text, that of an MD5
+   or SHA512 token the decoded digest.  The storage belongs to the lexer and
+   is valid at least until the next parse with the same IniParser. */
+struct ini_token
+{
+  const char *s;
+  size_t len;
+  operator std::string () const { return std::string (s, len); }
+  unsigned char const *digest () const { return (unsigned char const *) s; }
+};
+#define YYSTYPE ini_token
+
+/* Parses setup files into an IniDBBuilder.  The lexer and parser keep all
+   their state in here rather than in globals, so several setup files can be
+   parsed at once on different threads, each with its own IniParser (and
+   builder). */
+class IniParser
+{
+public:
+  IniParser (IniDBBuilder &, IniParseFeedback &);
+  ~IniParser ();
+  /* Parse ini, called name in messages.  Returns the number of errors,
+     which are described in errors (). */
+  int parse (io_stream *ini, const std::string& name);
+  const std::string& errors () const { return error_messages; }
+  /* Only run the lexer over ini and return the number of tokens in it;
+     for benchmarks. */
+  unsigned long scan (io_stream *ini, const std::string& name);
+
+  /* for the lexer and parser */
+  int lineno () const;
+  void error (const std::string& );
+  IniDBBuilder *builder;
+  IniParseFeedback &feedback;
+  io_stream *input;
+  void *scanner;
+private:
+  std::string name;
+  std::string error_messages;
+  int error_count;
+};
+int yyparse (IniParser *);
 
 /* When setup.ini is parsed, the information is stored according to
    the declarations here.  ini.cc (via inilex and iniparse)
@@ -49,15 +96,6 @@ typedef enum
   EXCLUDE_NOT_FOUND
 } excludes;
 
-/* The following three vars are used to facilitate error handling between the
-   parser/lexer and its callers, namely ini.cc:do_remote_ini() and
-   IniParseFindVisitor::visitFile().  */
-
-extern std::string current_ini_name;  /* current filename/URL being parsed */
-extern std::string current_ini_sig_name;  /* current filename/URL for sig file */
-extern std::string yyerror_messages;  /* textual parse error messages */
-extern int yyerror_count;             /* number of parse errors */
-
 /* The following definitions are used in the parser implementation */
 
 #define hexnibble(val)  ('\xff' & (val > '9') ? val - 'a' + 10 : val - '0')
@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+/* inigen writes a made-up setup.ini of any size, for testing how the
+   parser, the package database and the resolver scale.  The same options
+   and seed always give the same file. */
+
+#include "getopt++/GetOption.h"
+#include "getopt++/StringOption.h"
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+using namespace std;
+
+static StringOption PackagesOption ("1000", 'n', "packages", "Number of packages", false);
+static StringOption VersionsOption ("2", 'v', "versions", "Versions per package", false);
+static StringOption FanoutOption ("3", 'f', "fanout", "Average number of dependencies per version", false);
+static StringOption OrOption ("5", 'a', "or-ratio", "Percentage of dependencies with an alternative", false);
+static StringOption CategoriesOption ("40", 'c', "categories", "Number of categories", false);
+static StringOption DescriptionOption ("200", 'd', "description-size", "Average ldesc size in bytes", false);
+static StringOption ChainOption ("0", 'l', "chain", "Percentage of packages that depend on the one before them", false);
+static StringOption CyclesOption ("0", 'y', "cycles", "Percentage of packages in a dependency cycle with a later package", false);
+static StringOption VirtualOption ("0", 'p', "virtual", "Percentage of dependencies on a name the package provides instead of its own", false);
+static StringOption SeedOption ("1", 's', "seed", "Random seed", false);
+
+static unsigned long
+option_value (StringOption const &option)
+{
+  return strtoul (((std::string) option).c_str (), NULL, 10);
+}
+
+static const char *words[] = {
+  "library", "tool", "utility", "the", "for", "and", "a", "data", "file",
+  "network", "support", "runtime", "development", "files", "with", "of",
+  "compression", "format", "parser", "client", "server", "GNU", "fast",
+  "documentation", "bindings", "module", "system", "shared", "headers"
+};
+
+class Generator
+{
+public:
+  Generator () :
+    packages (option_value (PackagesOption)),
+    versions (max (option_value (VersionsOption), 1UL)),
+    fanout (option_value (FanoutOption)),
+    or_ratio (option_value (OrOption)),
+    categories (max (option_value (CategoriesOption), 1UL)),
+    description (option_value (DescriptionOption)),
+    chain (option_value (ChainOption)),
+    cycles (option_value (CyclesOption)),
+    virtuals (option_value (VirtualOption)),
+    random (option_value (SeedOption))
+  {}
+  void write (FILE *);
+private:
+  unsigned long below (unsigned long n) { return n ? random () % n : 0; }
+  bool percent (unsigned long p) { return below (100) < p; }
+  static std::string name (unsigned long i);
+  unsigned long dependency (unsigned long i);
+  void text (std::string &out, size_t size);
+  void digest (std::string &out);
+  void stanza (std::string &out, unsigned long i);
+
+  unsigned long packages, versions, fanout, or_ratio, categories,
+    description, chain, cycles, virtuals;
+  std::mt19937 random;
+  /* for each package, the earlier ones it must depend on to close their
+     cycles */
+  std::map<unsigned long, std::vector<unsigned long> > pending;
+};
+
+std::string
+Generator::name (unsigned long i)
+{
+  char buf[32];
+  snprintf (buf, sizeof buf, "pkg%lu", i);
+  return buf;
+}
+
+/* Packages depend on packages written before them, mostly on the first
+   few - the "core" of the distribution - so the graph is acyclic. */
+unsigned long
+Generator::dependency (unsigned long i)
+{
+  double u = random () / (random.max () + 1.0);
+  return (unsigned long) (i * u * u);
+}
+
+/* About size bytes of words, in lines of up to 70 columns. */
+void
+Generator::text (std::string &out, size_t size)
+{
+  size_t start = out.size (), column = 0;
+  while (out.size () - start < size)
+    {
+      const char *word = words[below (sizeof (words) / sizeof (*words))];
+      size_t len = strlen (word);
+      if (column && column + len >= 70)
+	{
+	  out += '\n';
+	  column = 0;
+	}
+      else if (column)
+	{
+	  out += ' ';
+	  ++column;
+	}
+      out += word;
+      column += len;
+    }
+}
+
+void
+Generator::digest (std::string &out)
+{
+  static const char hex[] = "0123456789abcdef";
+  for (int i = 0; i < 128; ++i)
+    out += hex[below (16)];
+}
+
+void
+Generator::stanza (std::string &out, unsigned long i)
+{
+  std::string n = name (i);
+  out += "@ " + n + "\nsdesc: \"";
+  text (out, 30);
+  out += "\"\nldesc: \"";
+  text (out, description / 2 + below (description + 1));
+  out += "\"\ncategory: cat" + to_string (below (categories));
+  if (percent (25))
+    out += " cat" + to_string (below (categories));
+  out += '\n';
+
+  /* A cycle: this package depends on a later one, which will depend on
+     this one in turn. */
+  std::vector<unsigned long> back;
+  std::map<unsigned long, std::vector<unsigned long> >::iterator p =
+    pending.find (i);
+  if (p != pending.end ())
+    {
+      back.swap (p->second);
+      pending.erase (p);
+    }
+  if (i + 1 < packages && percent (cycles))
+    {
+      unsigned long later = i + 1 + below (min (packages - i - 1, 100UL));
+      back.push_back (later);
+      pending[later].push_back (i);
+    }
+
+  /* Long chains make for a deep graph, where the default one is wide. */
+  bool chained = i && percent (chain);
+
+  for (unsigned long v = versions; v > 0; --v)
+    {
+      if (v != versions)
+	out += "[prev]\n";
+      std::string version = to_string (v) + "." + to_string (i % 10) + "-1";
+
+      std::set<unsigned long> deps;
+      unsigned long count = i ? below (2 * fanout + 1) : 0;
+      for (unsigned long d = 0; d < count; ++d)
+	deps.insert (dependency (i));
+      deps.insert (back.begin (), back.end ());
+      if (chained)
+	deps.insert (i - 1);
+      if (!deps.empty ())
+	{
+	  out += "requires:";
+	  for (std::set<unsigned long>::iterator d = deps.begin ();
+	       d != deps.end (); ++d)
+	    {
+	      out += " " + name (*d);
+	      if (percent (virtuals))
+		out += "-api";
+	      unsigned long alternative = dependency (i);
+	      if (percent (or_ratio) && alternative != *d)
+		out += " | " + name (alternative);
+	    }
+	  out += '\n';
+	}
+      if (virtuals)
+	out += "Provides: " + n + "-api\n";
+
+      std::string path = "x86_64/release/" + n + "/" + n + "-" + version;
+      out += "version: " + version + "\ninstall: " + path + ".tar.xz "
+	     + to_string (1000 + below (1000000)) + " ";
+      digest (out);
+      out += "\nsource: " + path + "-src.tar.xz "
+	     + to_string (1000 + below (1000000)) + " ";
+      digest (out);
+      out += '\n';
+    }
+  out += '\n';
+}
+
+void
+Generator::write (FILE *f)
+{
+  std::string out = "# This file was generated by inigen.\n"
+    "release: cygwin\n"
+    "arch: x86_64\n"
+    "setup-timestamp: 1458221732\n"
+    "setup-version: 2.874\n"
+    "\n";
+  for (unsigned long i = 0; i < packages; ++i)
+    {
+      stanza (out, i);
+      if (out.size () > 1024 * 1024)
+	{
+	  fwrite (out.data (), 1, out.size (), f);
+	  out.clear ();
+	}
+    }
+  fwrite (out.data (), 1, out.size (), f);
+}
+
+int
+main (int argc, char **argv)
+{
+  if (!GetOption::GetInstance().Process (argc,argv,NULL))
+    {
+      cout << "inigen writes a synthetic setup.ini to standard output" << endl;
+      cout << "usage: inigen [--packages=N] [--versions=N] [--fanout=N]" << endl;
+      cout << "  [--or-ratio=PERCENT] [--categories=N] [--description-size=BYTES]" << endl;
+      cout << "  [--chain=PERCENT] [--cycles=PERCENT] [--virtual=PERCENT] [--seed=N]" << endl;
+      return 1;
+    }
+#ifdef _WIN32
+  _setmode (_fileno (stdout), _O_BINARY);
+#endif
+  Generator ().write (stdout);
+  return ferror (stdout) ? 1 : 0;
+}
@@ -16,8 +16,8 @@
  */
 
 /* tokenize the setup.ini files.  We parse a string which we've
-   previously downloaded.  The program must call ini_init() to specify
-   that string. */
+   previously downloaded, passed to IniParser::parse().  The scanner is
+   reentrant; all its state is in the IniParser. */
 
 #include "win32.h"
 #include <string.h>
@@ -29,10 +29,13 @@
 #include "sha2.h"
 
 #define YY_READ_BUF_SIZE 65536
-#define YY_INPUT(buf,result,max_size) { result = ini_getchar(buf, max_size); }
+#define YY_INPUT(buf,result,max_size) { result = ini_getchar(yyextra, buf, max_size); }
+#define YY_DECL static int ini_lex (YYSTYPE *yylval_param, void *yyscanner)
 
-static int ini_getchar(char *buf, int max_size);
-static void ignore_line (void);
+static int ini_getchar(IniParser *parser, char *buf, int max_size);
+static void ignore_line (void *yyscanner);
+static void set_string (YYSTYPE *, const char *, size_t);
+static void set_digest (YYSTYPE *, unsigned char *, size_t);
 
 %}
 
@@ -41,6 +44,9 @@ static void ignore_line (void);
 %option noyywrap
 %option yylineno
 %option never-interactive
+%option reentrant
+%option bison-bridge
+%option extra-type="IniParser *"
 
 %x descriptionstate
 %x eolstate
@@ -52,37 +58,36 @@ B64	[a-zA-Z0-9_-]
 %%
 
 {HEX}{32} {
-    yylval = (char *) new unsigned char[16];
-    memset (yylval, 0, 16);
+    unsigned char *d = new unsigned char[16];
     int i, j;
     unsigned char v1, v2;
     for (i = 0, j = 0; i < 32; i += 2, ++j)
       {
 	v1 = hexnibble((unsigned char) yytext[i+0]);
 	v2 = hexnibble((unsigned char) yytext[i+1]);
-	((unsigned char *) yylval) [j] = nibbled1(v1, v2);
+	d[j] = nibbled1(v1, v2);
       }
+    set_digest (yylval, d, 16);
     return MD5;
 }
 
 {HEX}{128} {
-    yylval = (char *) new unsigned char[SHA512_DIGEST_LENGTH];
-    memset (yylval, 0, SHA512_DIGEST_LENGTH);
+    unsigned char *d = new unsigned char[SHA512_DIGEST_LENGTH];
     int i, j;
     unsigned char v1, v2;
     for (i = 0, j = 0; i < SHA512_BLOCK_LENGTH; i += 2, ++j)
       {
 	v1 = hexnibble((unsigned char) yytext[i+0]);
 	v2 = hexnibble((unsigned char) yytext[i+1]);
-	((unsigned char *) yylval) [j] = nibbled1(v1, v2);
+	d[j] = nibbled1(v1, v2);
       }
+    set_digest (yylval, d, SHA512_DIGEST_LENGTH);
     return SHA512;
 }
 
 {B64}{86} {
     /* base64url as defined in RFC4648 */
-    yylval = (char *) new unsigned char[SHA512_DIGEST_LENGTH];
-    memset (yylval, 0, SHA512_DIGEST_LENGTH);
+    unsigned char *d = new unsigned char[SHA512_DIGEST_LENGTH];
     int i, j;
     unsigned char v1, v2, v3, v4;
     for (i = 0, j = 0; i < 4*(SHA512_DIGEST_LENGTH/3); i += 4, j += 3)
@@ -91,21 +96,20 @@ B64	[a-zA-Z0-9_-]
 	v2 = b64url(((unsigned char) yytext[i+1]));
 	v3 = b64url(((unsigned char) yytext[i+2]));
 	v4 = b64url(((unsigned char) yytext[i+3]));
-	((unsigned char *) yylval) [j+0] = b64d1(v1, v2, v3, v4);
-	((unsigned char *) yylval) [j+1] = b64d2(v1, v2, v3, v4);
-	((unsigned char *) yylval) [j+2] = b64d3(v1, v2, v3, v4);
+	d[j+0] = b64d1(v1, v2, v3, v4);
+	d[j+1] = b64d2(v1, v2, v3, v4);
+	d[j+2] = b64d3(v1, v2, v3, v4);
       }
     v1 = b64url((unsigned char) yytext[i+0]);
     v2 = b64url((unsigned char) yytext[i+1]);
     v3 = 0;
     v4 = 0;
-    ((unsigned char *) yylval) [j+0] = b64d1(v1, v2, v3, v4);
+    d[j+0] = b64d1(v1, v2, v3, v4);
+    set_digest (yylval, d, SHA512_DIGEST_LENGTH);
     return SHA512;
 }
 
-\"[^"]*\"		{ yylval = new char [strlen (yytext+1) + 1];
-			  strcpy (yylval, yytext+1);
-			  yylval[strlen (yylval)-1] = 0;
+\"[^"]*\"		{ set_string (yylval, yytext + 1, yyleng - 2);
 			  return STRING; }
 
 "setup-timestamp:"	return SETUP_TIMESTAMP;
@@ -153,7 +157,7 @@ B64	[a-zA-Z0-9_-]
 
 "download-url:"		return DOWNLOAD_URL;
 
-^{STR}":"		ignore_line ();
+^{STR}":"		ignore_line (yyscanner);
 
 "[curr]"		return T_CURR;
 "[test]"		return T_TEST;
@@ -176,22 +180,20 @@ B64	[a-zA-Z0-9_-]
 "|"			return OR;
 "@"			return AT;
 
-{STR}"@"{STR}		{ yylval = new char [strlen(yytext) + 1];
-    			  strcpy (yylval, yytext);
+{STR}"@"{STR}		{ set_string (yylval, yytext, yyleng);
 			  return EMAIL; }
-{STR}			{ yylval = new char [strlen(yytext) + 1];
-  			  strcpy (yylval, yytext);
+{STR}			{ set_string (yylval, yytext, yyleng);
 			  return STRING; }
 
 [ \t\r]+		/* do nothing */;
 
 ^"#".*\n		/* do nothing */;
-<descriptionstate>[^\n]+	{ yylval = new char [strlen(yytext) + 1];
-    				  strcpy (yylval, yytext);
+<descriptionstate>[^\n]+	{ set_string (yylval, yytext, yyleng);
 				  return STRTOEOL; }
 <descriptionstate>\n	{ return NL; }
 <descriptionstate>"\n"+	{BEGIN(INITIAL); return PARAGRAPH;}
-<eolstate>[^\n]+	{return STRING; }
+<eolstate>[^\n]+	{ set_string (yylval, yytext, yyleng);
+			  return STRING; }
 <eolstate>\n		{BEGIN(INITIAL); return NL; }
 
 \n			{ return NL; }
@@ -201,47 +203,114 @@ B64	[a-zA-Z0-9_-]
 
 #include "io_stream.h"
 
-static io_stream *input_stream = 0;
-extern IniDBBuilder *iniBuilder;
-static IniParseFeedback *iniFeedback;
-std::string current_ini_name, yyerror_messages;
-int yyerror_count;
+const char *ini_lexer_name = "flex";
+
+int
+yylex (YYSTYPE *lval, IniParser *parser)
+{
+  return ini_lex (lval, parser->scanner);
+}
+
+IniParser::IniParser (IniDBBuilder &aBuilder, IniParseFeedback &aFeedback) :
+  builder (&aBuilder), feedback (aFeedback), input (NULL), scanner (NULL),
+  error_count (0)
+{
+}
+
+IniParser::~IniParser ()
+{
+}
+
+int
+IniParser::parse (io_stream *stream, const std::string& aName)
+{
+  name = aName;
+  error_count = 0;
+  error_messages.clear ();
+  input = stream;
+  yylex_init_extra (this, &scanner);
+
+  if (yyparse (this) && !error_count)
+    error_count = 1;
+
+  yylex_destroy (scanner);
+  scanner = NULL;
+  input = NULL;
+  return error_count;
+}
+
+unsigned long
+IniParser::scan (io_stream *stream, const std::string& aName)
+{
+  name = aName;
+  error_count = 0;
+  error_messages.clear ();
+  input = stream;
+  yylex_init_extra (this, &scanner);
+
+  unsigned long tokens = 0;
+  YYSTYPE lval;
+  while (yylex (&lval, this))
+    ++tokens;
+
+  yylex_destroy (scanner);
+  scanner = NULL;
+  input = NULL;
+  return tokens;
+}
 
-void
-ini_init(io_stream *stream, IniDBBuilder *aBuilder, IniParseFeedback &aFeedback)
+int
+IniParser::lineno () const
 {
-  input_stream = stream;
-  iniBuilder = aBuilder;
-  iniFeedback = &aFeedback;
-  YY_FLUSH_BUFFER;
-  yylineno = 1;
-  yyerror_count = 0;
-  yyerror_messages.clear ();
+  struct yyguts_t *yyg = (struct yyguts_t *) scanner;
+  if (!YY_CURRENT_BUFFER)
+    return 1;
+  return yylineno - (!!YY_AT_BOL ());
 }
 
 static int
-ini_getchar(char *buf, int max_size)
+ini_getchar(IniParser *parser, char *buf, int max_size)
 {
-  if (input_stream)
+  if (parser->input)
     {
-      ssize_t len = input_stream->read (buf, max_size);
+      ssize_t len = parser->input->read (buf, max_size);
       if (len < 1)
         {
 	  len = 0;
-	  input_stream = 0;
+	  parser->input = 0;
 	}
       else
-        iniFeedback->progress (input_stream->tell(), input_stream->get_size());
+        parser->feedback.progress (parser->input->tell(),
+				   parser->input->get_size());
       return len;
     }
   return 0;
 }
 
+/* yytext is reused for the next token, so token values are copies; they
+   are never freed. */
+static void
+set_string (YYSTYPE *lval, const char *s, size_t len)
+{
+  char *t = new char [len + 1];
+  memcpy (t, s, len);
+  t[len] = 0;
+  lval->s = t;
+  lval->len = len;
+}
+
+static void
+set_digest (YYSTYPE *lval, unsigned char *d, size_t len)
+{
+  lval->s = (char *) d;
+  lval->len = len;
+}
+
 static void
-ignore_line ()
+ignore_line (void *yyscanner)
 {
   char c;
-  while ((c = yyinput ()))
+  while ((c = yyinput (yyscanner)))
     {
       if (c == EOF)
 	return;
@@ -249,21 +318,3 @@ ignore_line ()
 	return;
     }
 }
-
-int
-yyerror (const std::string& s)
-{
-  char tmp[16];
-  sprintf (tmp, "%d", yylineno - (!!YY_AT_BOL ()));
-  
-  std::string e = current_ini_name + " line " + tmp + ": " + s;
-  
-  if (!yyerror_messages.empty ())
-    yyerror_messages += "\n";
-
-  yyerror_messages += e;
-  // OutputDebugString (e.c_str ());
-  yyerror_count++;
-  /* TODO: is return 0 correct? */
-  return 0;
-}
@@ -19,42 +19,548 @@ static const char *cvsid =
 #endif
 
 #include "getopt++/GetOption.h"
+#include "getopt++/BoolOption.h"
+#include "getopt++/StringOption.h"
+#include <chrono>
 #include <iostream>
-#include <sstream>
+#include <new>
+#include <stdlib.h>
+#include <windows.h>
+#include <psapi.h>
+
+#include "IncrementalResolver.h"
+#include "ini.h"
+#include "IniDBBuilder.h"
+#include "IniDBBuilderPackage.h"
+#include "IniDBSnapshot.h"
+#include "IniParseFeedback.h"
+#include "io_stream.h"
+#include "io_stream_memory.h"
+#include "LogSingleton.h"
+#include "NullLog.h"
+#include "package_db.h"
+#include "package_meta.h"
+#include "PackageClosure.h"
+#include "SatResolver.h"
 using namespace std;
 
-extern int yylineno;
+static BoolOption StatsOption (false, 's', "stats", "Report lexer throughput and allocation count");
+static StringOption BenchOption ("", 'b', "bench", "Parse each file N times into the package database and report timings", false);
 
-static ostringstream error_buf;
-static int error_count = 0;
+/* Every allocation made while parsing is counted, so that the per-token
+   copies of the flex lexer can be compared with iniscan. */
+static unsigned long allocations;
 
-extern int
-yyerror (const std::string& s)
+void *
+operator new (size_t size)
 {
-  ostringstream buf;
-  buf << "setup.ini line " << yylineno << ": ";
-  buf << s << endl;
-  cout << buf;
-  error_buf << buf; 
-  error_count++;
-  /* TODO: is return 0 correct? */
-  return 0;
+  ++allocations;
+  void *p = malloc (size ? size : 1);
+  if (!p)
+    throw std::bad_alloc ();
+  return p;
+}
+
+void
+operator delete (void *p) noexcept
+{
+  free (p);
 }
 
+/* Builds nothing; inilint only cares whether the file parses. */
+class IniDBBuilderLint : public IniDBBuilder
+{
+public:
+  virtual void buildTimestamp (const std::string& ) {}
+  virtual void buildVersion (const std::string& ) {}
+  virtual void buildPackage (const std::string& ) {}
+  virtual void buildPackageVersion (const std::string& ) {}
+  virtual void buildPackageSDesc (const std::string& ) {}
+  virtual void buildPackageLDesc (const std::string& ) {}
+  virtual void buildPackageInstall (const std::string& ) {}
+  virtual void buildPackageSource (const std::string&, const std::string&) {}
+  virtual void buildSourceFile (unsigned char const[16],
+				const std::string&, const std::string&) {}
+  virtual void buildPackageTrust (int) {}
+  virtual void buildPackageCategory (const std::string& ) {}
+  virtual void buildBeginDepends () {}
+  virtual void buildBeginPreDepends () {}
+  virtual void buildPriority (const std::string& ) {}
+  virtual void buildInstalledSize (const std::string& ) {}
+  virtual void buildMaintainer (const std::string& ) {}
+  virtual void buildArchitecture (const std::string& ) {}
+  virtual void buildInstallSize (const std::string& ) {}
+  virtual void buildInstallSHA512 (unsigned char const[64]) {}
+  virtual void buildSourceSHA512 (unsigned char const[64]) {}
+  virtual void buildInstallMD5 (unsigned char const[16]) {}
+  virtual void buildSourceMD5 (unsigned char const[16]) {}
+  virtual void buildBeginRecommends () {}
+  virtual void buildBeginSuggests () {}
+  virtual void buildBeginReplaces () {}
+  virtual void buildBeginConflicts () {}
+  virtual void buildBeginProvides () {}
+  virtual void buildBeginBuildDepends () {}
+  virtual void buildBeginBinary () {}
+  virtual void buildDescription (const std::string& ) {}
+  virtual void buildSourceName (const std::string& ) {}
+  virtual void buildSourceNameVersion (const std::string& ) {}
+  virtual void buildPackageListAndNode () {}
+  virtual void buildPackageListOrNode (const std::string& ) {}
+  virtual void buildPackageListOperator (PackageSpecification::_operators const &) {}
+  virtual void buildPackageListOperatorVersion (const std::string& ) {}
+  virtual void buildMessage (const std::string&, const std::string&) {}
+};
+
 void
 show_help()
 {
   cout << "inilint checks cygwin setup.ini files and reports any errors with" << endl;
   cout << "diagnostics" << endl;
+  cout << "usage: inilint [--stats] [--bench=N] setup.ini..." << endl;
+}
+
+static double
+seconds_since (chrono::steady_clock::time_point start)
+{
+  chrono::duration<double> elapsed = chrono::steady_clock::now () - start;
+  return elapsed.count ();
+}
+
+static io_stream *
+memory_copy (const std::string& text)
+{
+  io_stream *s = new io_stream_memory;
+  s->write (text.data (), text.size ());
+  s->seek (0, IO_SEEK_SET);
+  return s;
+}
+
+static size_t
+peak_rss ()
+{
+  PROCESS_MEMORY_COUNTERS pmc;
+  if (GetProcessMemoryInfo (GetCurrentProcess (), &pmc, sizeof (pmc)))
+    return pmc.PeakWorkingSetSize;
+  return 0;
+}
+
+/* Resolve the requirements of whatever is picked, with the SAT solver or
+   with set_requirements ().  touched is set to the number of packages
+   changed by the former or looked at by the latter. */
+static void
+resolve_picked (bool sat, size_t &touched)
+{
+  packagedb db;
+  touched = 0;
+  if (sat)
+    {
+      SatResolver resolver (TRUST_CURR);
+      if (resolver.resolve ())
+	touched = resolver.changes ();
+      return;
+    }
+  db.markUnVisited ();
+  for (packagedb::packagecollection::iterator i = db.packages.begin ();
+       i != db.packages.end (); ++i)
+    i->second->set_requirements (TRUST_CURR, touched);
+}
+
+/* Resolve the dependencies of every package in the database, as if the
+   user had picked the current version of each in the chooser.  Returns
+   the time taken. */
+static double
+resolve (bool sat, size_t &touched)
+{
+  packagedb db;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now ();
+  for (packagedb::packagecollection::iterator i = db.packages.begin ();
+       i != db.packages.end (); ++i)
+    {
+      packagemeta &pkg = *i->second;
+      pkg.desired = pkg.trustp (true, TRUST_CURR);
+      if (pkg.desired)
+	pkg.desired.pick (true, NULL);
+    }
+  resolve_picked (sat, touched);
+  return seconds_since (start);
+}
+
+/* Drop every selection.  Returns the package added last - which in
+   inigen output is the one with the most dependencies below it. */
+static packagemeta *
+drop_selections ()
+{
+  packagedb db;
+  for (packagedb::packagecollection::iterator i = db.packages.begin ();
+       i != db.packages.end (); ++i)
+    {
+      packagemeta &pkg = *i->second;
+      if (pkg.desired)
+	pkg.desired.pick (false, NULL);
+      pkg.desired = packageversion ();
+    }
+  packagemeta *last = NULL;
+  for (PackageCollection::id_type i = db.packages.ids (); !last && i; --i)
+    last = db.packages[i - 1];
+  return last;
+}
+
+static void
+pick_current (packagemeta *pkg)
+{
+  pkg->desired = pkg->trustp (true, TRUST_CURR);
+  if (pkg->desired)
+    pkg->desired.pick (true, NULL);
+}
+
+/* Drop every selection, then pick only the package added last and resolve
+   it.  Returns the time taken; picked is set to the number of
+   packages selected in the end. */
+static double
+resolve_last (bool sat, size_t &touched, size_t &picked)
+{
+  packagedb db;
+  packagemeta *last = drop_selections ();
+  touched = 0;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now ();
+  if (last)
+    {
+      pick_current (last);
+      resolve_picked (sat, touched);
+    }
+  double elapsed = seconds_since (start);
+  picked = 0;
+  for (packagedb::packagecollection::iterator i = db.packages.begin ();
+       i != db.packages.end (); ++i)
+    if (i->second->desired)
+      ++picked;
+  return elapsed;
+}
+
+/* Install the first version of every other package and keep it, then
+   pick the package added last and resolve the lot, by set_requirements ()
+   or by the SAT solver.  Returns how many of the installed packages that
+   removed or changed the version of.  Nothing is installed afterwards. */
+static size_t
+installed_changes (bool sat)
+{
+  packagedb db;
+  packagemeta *last = drop_selections ();
+  for (PackageCollection::id_type i = 0; i < db.packages.ids (); i += 2)
+    {
+      packagemeta *pkg = db.packages[i];
+      if (pkg && !pkg->versions.empty ())
+	pkg->desired = pkg->installed = *pkg->versions.begin ();
+    }
+  if (last)
+    pick_current (last);
+  size_t touched, changes = 0;
+  resolve_picked (sat, touched);
+  for (packagedb::packagecollection::iterator i = db.packages.begin ();
+       i != db.packages.end (); ++i)
+    {
+      packagemeta &pkg = *i->second;
+      if (pkg.installed && pkg.desired != pkg.installed)
+	++changes;
+      pkg.installed = packageversion ();
+    }
+  return changes;
+}
+
+/* resolve_last () by an IncrementalResolver, as the chooser does it when
+   the last package is clicked: from that package only, or with the SAT
+   solver as a whole.  The package is clicked twice, with the selections
+   dropped in between, and first is set to the time the first click took,
+   which for the SAT solver includes encoding the database.  changed is set
+   to the number of packages whose selection the second click changed. */
+static double
+resolve_last_incrementally (bool sat, size_t &touched, size_t &changed,
+			    double &first)
+{
+  IncrementalResolver resolver;
+  resolver.useSatSolver (sat);
+  touched = changed = 0;
+  first = 0;
+  double took = 0;
+  for (int click = 0; click < 2; ++click)
+    {
+      packagemeta *last = drop_selections ();
+      if (!last)
+	break;
+      chrono::steady_clock::time_point start = chrono::steady_clock::now ();
+      pick_current (last);
+      resolver.changed (last);
+      changed = resolver.resolve (TRUST_CURR).size ();
+      touched = resolver.touched ();
+      took = seconds_since (start);
+      if (!click)
+	first = took;
+    }
+  return took;
+}
+
+/* The closures of the package added last, and of every hundredth package
+   together, by a PackageClosure built first.  Returns the time taken for
+   each in building, last and batch; lastSize and batchSize are set to the
+   sizes of the closures. */
+static void
+closures (double &building, double &last, double &batch, size_t &lastSize,
+	  size_t &batchSize)
+{
+  packagedb db;
+  PackageClosure closure (TRUST_CURR);
+  chrono::steady_clock::time_point start = chrono::steady_clock::now ();
+  closure.build ();
+  building = seconds_since (start);
+  last = batch = 0;
+  lastSize = batchSize = 0;
+  if (!db.packages.ids ())
+    return;
+  start = chrono::steady_clock::now ();
+  lastSize = closure.of (db.packages.ids () - 1).size ();
+  last = seconds_since (start);
+  std::vector<PackageCollection::id_type> roots;
+  for (PackageCollection::id_type i = 0; i < db.packages.ids (); i += 100)
+    roots.push_back (i);
+  PackageClosure::Set together;
+  start = chrono::steady_clock::now ();
+  closure.of (roots, together);
+  batch = seconds_since (start);
+  batchSize = together.size ();
+}
+
+/* Save the package database snapshot of the setup file name, with the
+   contents text, next to it, and build the database from it again, with
+   the descriptions copied and then referred to.  Returns the time taken
+   for each in saving, loading and loadingLazily, and the size of the
+   snapshot in bytes; or 0 if it couldn't be saved. */
+static size_t
+snapshot (const std::string& name, const std::string& text, double &saving,
+	  double &loading, double &loadingLazily)
+{
+  IniParseFeedback feedback;
+  IniDBSnapshotRecorder recorder;
+  recorder.beginIni (name);
+  IniParser parser (recorder, feedback);
+  io_stream *in = memory_copy (text);
+  parser.parse (in, name);
+  delete in;
+  unsigned char digest[SHA512_DIGEST_LENGTH];
+  SHA2_CTX ctx;
+  SHA512Init (&ctx);
+  SHA512Update (&ctx, (uint8_t const *) text.data (), text.size ());
+  SHA512Final (digest, &ctx);
+  recorder.endIni (digest);
+
+  std::string url = "file://" + name + ".snapshot";
+  chrono::steady_clock::time_point start = chrono::steady_clock::now ();
+  if (IniDBSnapshot::save (url, digest, recorder))
+    return 0;
+  saving = seconds_since (start);
+  for (int lazy = 1; lazy >= 0; --lazy)
+    {
+      packagedb::clear ();
+      DescriptionText::lazy = lazy;
+      IniDBBuilderPackage builder (feedback);
+      start = chrono::steady_clock::now ();
+      IniDBSnapshot::load (url, digest, builder);
+      (lazy ? loadingLazily : loading) = seconds_since (start);
+    }
+  io_stream::remove (url);
+  return recorder.data ().size ();
+}
+
+/* Parse name runs times from memory into the real package database.  Each
+   run also times the lexer alone and the parser feeding the do-nothing
+   builder above, so the differences between the three give the time spent
+   in the lexer, the parser actions and IniDBBuilderPackage.  The last
+   database built is then resolved, as a whole and from its last package,
+   by set_requirements () and by the SAT solver, and from its last package
+   by an IncrementalResolver; and its closures are worked out.  Before
+   that, the database is saved as a snapshot and loaded from it. */
+static int
+bench (const std::string& name, unsigned long runs)
+{
+  io_stream *ini = io_stream::open ("file://" + name, "rb", 0);
+  if (!ini)
+    {
+      cout << name << ": cannot open" << endl;
+      return 1;
+    }
+  std::string text;
+  char buffer[64 * 1024];
+  ssize_t count;
+  while ((count = ini->read (buffer, sizeof (buffer))) > 0)
+    text.append (buffer, count);
+  delete ini;
+
+  IniParseFeedback feedback;
+  IniDBBuilderLint lint;
+  double lexing = 0, parsing = 0, building = 0;
+  unsigned long tokens = 0, packages = 0, allocs = 0;
+  for (unsigned long run = 0; run < runs; ++run)
+    {
+      IniParser lexer (lint, feedback);
+      io_stream *in = memory_copy (text);
+      chrono::steady_clock::time_point start = chrono::steady_clock::now ();
+      tokens = lexer.scan (in, name);
+      lexing += seconds_since (start);
+      delete in;
+
+      IniParser parser (lint, feedback);
+      in = memory_copy (text);
+      start = chrono::steady_clock::now ();
+      int errors = parser.parse (in, name);
+      parsing += seconds_since (start);
+      delete in;
+      if (errors)
+	{
+	  cout << parser.errors () << endl;
+	  return 1;
+	}
+
+      packagedb::clear ();
+      IniDBBuilderPackage builder (feedback);
+      builder.parse_mirror = name;
+      IniParser loader (builder, feedback);
+      in = memory_copy (text);
+      unsigned long before = allocations;
+      start = chrono::steady_clock::now ();
+      loader.parse (in, name);
+      building += seconds_since (start);
+      allocs += allocations - before;
+      delete in;
+      packages = packagedb::packages.size ();
+    }
+  double saving = 0, loading = 0, loadingLazily = 0;
+  size_t snapshotSize = snapshot (name, text, saving, loading, loadingLazily);
+  size_t touched[2], touchedLast[2], picked[2];
+  double resolving[2], resolvingLast[2];
+  size_t cached = 0, checked = 0;
+  for (int sat = 0; sat < 2; ++sat)
+    {
+      resolving[sat] = resolve (sat, touched[sat]);
+      if (!sat)
+	packageversion::versionChecksThisPass (cached, checked);
+      resolvingLast[sat] = resolve_last (sat, touchedLast[sat], picked[sat]);
+    }
+  size_t touchedChange[2], changed[2];
+  double resolvingChange[2], resolvingFirst[2];
+  for (int sat = 0; sat < 2; ++sat)
+    resolvingChange[sat] = resolve_last_incrementally (sat, touchedChange[sat],
+						       changed[sat],
+						       resolvingFirst[sat]);
+  size_t installedChanges[2];
+  for (int sat = 0; sat < 2; ++sat)
+    installedChanges[sat] = installed_changes (sat);
+  double closing, closingLast, closingBatch;
+  size_t closureLast, closureBatch;
+  closures (closing, closingLast, closingBatch, closureLast, closureBatch);
+
+  double mb = text.size () / (1024.0 * 1024.0) * runs;
+  cout << name << ": " << ini_lexer_name << ", " << runs << " runs of "
+       << text.size () << " bytes, " << tokens << " tokens, " << packages
+       << " packages" << endl;
+  if (building > 0)
+    cout << "  " << mb / building << " MB/s, "
+	 << tokens * runs / building << " tokens/s, "
+	 << packages * runs / building << " packages/s" << endl;
+  cout << "  " << allocs / runs << " allocations per run, peak RSS "
+       << peak_rss () / 1024 << " KiB" << endl;
+  cout << "  per run: lexer " << lexing * 1000 / runs << " ms, parser actions "
+       << (parsing - lexing) * 1000 / runs << " ms, builder "
+       << (building - parsing) * 1000 / runs << " ms" << endl;
+  if (snapshotSize)
+    cout << "  snapshot of " << snapshotSize << " bytes: saving "
+	 << saving * 1000 << " ms, loading " << loading * 1000 << " ms, "
+	 << loadingLazily * 1000 << " ms with lazy descriptions, "
+	 << packagedb::packages.size () << " packages" << endl;
+  else
+    cout << "  snapshot: cannot save" << endl;
+  cout << "  resolving all packages: " << resolving[0] * 1000 << " ms, "
+       << touched[0] << " packages touched, " << cached << " of " << checked
+       << " version checks cached" << endl;
+  cout << "  resolving the last package: " << resolvingLast[0] * 1000
+       << " ms, " << touchedLast[0] << " packages touched, " << picked[0]
+       << " packages picked" << endl;
+  cout << "  resolving the last package incrementally: "
+       << resolvingChange[0] * 1000 << " ms, " << touchedChange[0]
+       << " packages touched, " << changed[0] << " packages changed" << endl;
+  cout << "  closures: " << closing * 1000 << " ms building, "
+       << closingLast * 1000 << " ms for the last package (" << closureLast
+       << " packages), " << closingBatch * 1000 << " ms for every 100th ("
+       << closureBatch << " packages)" << endl;
+  cout << "  SAT solving all packages: " << resolving[1] * 1000 << " ms, "
+       << touched[1] << " packages changed" << endl;
+  cout << "  SAT solving the last package: " << resolvingLast[1] * 1000
+       << " ms, " << touchedLast[1] << " packages changed, " << picked[1]
+       << " packages picked" << endl;
+  cout << "  SAT solving the last package on a click: "
+       << resolvingChange[1] * 1000 << " ms, " << changed[1]
+       << " packages changed (" << resolvingFirst[1] * 1000
+       << " ms on the first click, which encodes the database)" << endl;
+  cout << "  installed packages removed or changed when the last package is"
+       << " picked: " << installedChanges[0] << " by set_requirements (), "
+       << installedChanges[1] << " by the SAT solver" << endl;
+  return 0;
+}
+
+static int
+lint (const std::string& name)
+{
+  io_stream *ini = io_stream::open ("file://" + name, "rb", 0);
+  if (!ini)
+    {
+      cout << name << ": cannot open" << endl;
+      return 1;
+    }
+  size_t bytes = ini->get_size ();
+
+  IniDBBuilderLint builder;
+  IniParseFeedback feedback;
+  IniParser parser (builder, feedback);
+  unsigned long before = allocations;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now ();
+
+  int failed = parser.parse (ini, name) > 0;
+
+  chrono::duration<double> elapsed = chrono::steady_clock::now () - start;
+  unsigned long allocs = allocations - before;
+  delete ini;
+
+  if (failed)
+    cout << parser.errors () << endl;
+  if (StatsOption)
+    {
+      double secs = elapsed.count ();
+      cout << name << ": " << ini_lexer_name << ", " << bytes << " bytes in "
+	   << secs * 1000 << " ms";
+      if (secs > 0)
+	cout << " (" << bytes / secs / (1024 * 1024) << " MB/s)";
+      cout << ", " << allocs << " allocations" << endl;
+    }
+  return failed;
 }
 
 int
 main (int argc, char **argv)
 {
-  if (!GetOption::GetInstance().Process (argc,argv,NULL))
+  if (!GetOption::GetInstance().Process (argc,argv,NULL)
+      || GetOption::GetInstance().nonOptions ().empty ())
     {
       show_help();
       return 1;
     }
-  return 0;
+
+  unsigned long runs = strtoul (((std::string) BenchOption).c_str (), NULL,
+			       10);
+  NullLog log;
+  if (runs)
+    LogSingleton::SetInstance (log);
+
+  int errors = 0;
+  vector<string> const &files = GetOption::GetInstance().nonOptions ();
+  for (vector<string>::const_iterator i = files.begin (); i != files.end (); ++i)
+    errors += runs ? bench (*i, runs) : lint (*i);
+  return errors ? 1 : 0;
 }
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+/* inilint --bench links the package database, but not the rest of the
+   installer.  These stand in for the few parts of it the database refers
+   to; none of them is reached while a setup file is parsed. */
+
+#include <stdlib.h>
+#include "download.h"
+#include "mount.h"
+#include "msg.h"
+
+bool is_64bit = sizeof (void *) == 8;
+
+int
+check_for_cached (packagesource &, bool)
+{
+  return 0;
+}
+
+std::string
+cygpath (const std::string& path)
+{
+  return path;
+}
+
+void
+fatal (HWND, int, ...)
+{
+  exit (1);
+}
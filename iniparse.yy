@@ -22,21 +22,25 @@
 #include "iniparse.hh"
 #include "PackageTrust.h"
 
-extern int yyerror (const std::string& s);
-int yylex ();
-
 #include "IniDBBuilder.h"
 
+int yylex (YYSTYPE *, IniParser *);
+static void yyerror (IniParser *parser, const std::string& s)
+{
+  parser->error (s);
+}
+
 #define YYERROR_VERBOSE 1
 #define YYINITDEPTH 1000
 /*#define YYDEBUG 1*/
 
-IniDBBuilder *iniBuilder;
-extern int yylineno;
-
 void add_correct_version();
 %}
 
+%define api.pure
+%parse-param { IniParser *parser }
+%lex-param { IniParser *parser }
+
 %token STRING 
 %token SETUP_TIMESTAMP SETUP_VERSION PACKAGEVERSION INSTALL SOURCE SDESC LDESC
 %token CATEGORY DEPENDS REQUIRES
@@ -65,10 +69,10 @@ setup_headers: /* empty */
  ;
  
 header /* non-empty */
- : SETUP_TIMESTAMP STRING	{ iniBuilder->buildTimestamp ($2); } NL
- | SETUP_VERSION STRING		{ iniBuilder->buildVersion ($2); } NL
- | RELEASE STRING		{ iniBuilder->set_release ($2); } NL
- | ARCH STRING 			{ iniBuilder->set_arch ($2); } NL
+ : SETUP_TIMESTAMP STRING	{ parser->builder->buildTimestamp ($2); } NL
+ | SETUP_VERSION STRING		{ parser->builder->buildVersion ($2); } NL
+ | RELEASE STRING		{ parser->builder->set_release ($2); } NL
+ | ARCH STRING 			{ parser->builder->set_arch ($2); } NL
  ;
 
 packages: /* empty */
@@ -84,8 +88,8 @@ package /* non-empty */
  ;
 
 packagename /* non-empty */
- : AT STRING		{ iniBuilder->buildPackage ($2); }
- | PACKAGENAME STRING	{ iniBuilder->buildPackage ($2); }
+ : AT STRING		{ parser->builder->buildPackage ($2); }
+ | PACKAGENAME STRING	{ parser->builder->buildPackage ($2); }
  ;
 
 packagedata: /* empty */
@@ -93,99 +97,99 @@ packagedata: /* empty */
  ;
 
 singleitem /* non-empty */
- : PACKAGEVERSION STRING NL	{ iniBuilder->buildPackageVersion ($2); }
- | SDESC STRING NL		{ iniBuilder->buildPackageSDesc($2); }
- | LDESC STRING NL		{ iniBuilder->buildPackageLDesc($2); }
- | T_PREV NL 			{ iniBuilder->buildPackageTrust (TRUST_PREV); }
- | T_CURR NL			{ iniBuilder->buildPackageTrust (TRUST_CURR); }
- | T_TEST NL			{ iniBuilder->buildPackageTrust (TRUST_TEST); }
- | T_OTHER NL			{ iniBuilder->buildPackageTrust (TRUST_OTHER); }
- | PRIORITY STRING NL		{ iniBuilder->buildPriority ($2); }
- | INSTALLEDSIZE STRING NL	{ iniBuilder->buildInstalledSize ($2); }
- | MAINTAINER STRING NL		{ iniBuilder->buildMaintainer ($2); }
- | ARCHITECTURE packagearchspec NL 	{ iniBuilder->buildArchitecture ($2); }
- | FILESIZE STRING NL		{ iniBuilder->buildInstallSize($2); }
+ : PACKAGEVERSION STRING NL	{ parser->builder->buildPackageVersion ($2); }
+ | SDESC STRING NL		{ parser->builder->buildPackageSDesc($2); }
+ | LDESC STRING NL		{ parser->builder->buildPackageLDesc($2); }
+ | T_PREV NL 			{ parser->builder->buildPackageTrust (TRUST_PREV); }
+ | T_CURR NL			{ parser->builder->buildPackageTrust (TRUST_CURR); }
+ | T_TEST NL			{ parser->builder->buildPackageTrust (TRUST_TEST); }
+ | T_OTHER NL			{ parser->builder->buildPackageTrust (TRUST_OTHER); }
+ | PRIORITY STRING NL		{ parser->builder->buildPriority ($2); }
+ | INSTALLEDSIZE STRING NL	{ parser->builder->buildInstalledSize ($2); }
+ | MAINTAINER STRING NL		{ parser->builder->buildMaintainer ($2); }
+ | ARCHITECTURE packagearchspec NL 	{ parser->builder->buildArchitecture ($2); }
+ | FILESIZE STRING NL		{ parser->builder->buildInstallSize($2); }
  | FORMAT STRING NL		{ /* TODO */ }
  | DIRECTORY STRING NL		{ /* TODO */ }
  | STANDARDSVERSION STRING NL	{ /* TODO */ }
- | MD5LINE MD5 NL	{ iniBuilder->buildInstallMD5 ((unsigned char *)$2); }
- | SHA512LINE SHA512 NL		{ iniBuilder->buildInstallSHA512 ((unsigned char *)$2); }
+ | MD5LINE MD5 NL	{ parser->builder->buildInstallMD5 ($2.digest ()); }
+ | SHA512LINE SHA512 NL		{ parser->builder->buildInstallSHA512 ($2.digest ()); }
  | SOURCEPACKAGE source NL
  | CATEGORY categories NL
- | INSTALL STRING { iniBuilder->buildPackageInstall ($2); } installmeta NL
- | SOURCE STRING STRING sourcechksum NL {iniBuilder->buildPackageSource ($2, $3);}
- | PROVIDES 		{ iniBuilder->buildBeginProvides(); } packagelist NL
- | BINARYPACKAGE  { iniBuilder->buildBeginBinary (); } packagelist NL
- | CONFLICTS	{ iniBuilder->buildBeginConflicts(); } versionedpackagelist NL
- | DEPENDS { iniBuilder->buildBeginDepends(); } versionedpackagelist NL
- | REQUIRES { iniBuilder->buildBeginDepends(); } versionedpackagelistsp NL
- | PREDEPENDS { iniBuilder->buildBeginPreDepends(); } versionedpackagelist NL
- | RECOMMENDS { iniBuilder->buildBeginRecommends(); }   versionedpackagelist NL
- | SUGGESTS { iniBuilder->buildBeginSuggests(); } versionedpackagelist NL
- | REPLACES { iniBuilder->buildBeginReplaces(); }       versionedpackagelist NL
- | BUILDDEPENDS { iniBuilder->buildBeginBuildDepends(); } versionedpackagelist NL
+ | INSTALL STRING { parser->builder->buildPackageInstall ($2); } installmeta NL
+ | SOURCE STRING STRING sourcechksum NL {parser->builder->buildPackageSource ($2, $3);}
+ | PROVIDES 		{ parser->builder->buildBeginProvides(); } packagelist NL
+ | BINARYPACKAGE  { parser->builder->buildBeginBinary (); } packagelist NL
+ | CONFLICTS	{ parser->builder->buildBeginConflicts(); } versionedpackagelist NL
+ | DEPENDS { parser->builder->buildBeginDepends(); } versionedpackagelist NL
+ | REQUIRES { parser->builder->buildBeginDepends(); } versionedpackagelistsp NL
+ | PREDEPENDS { parser->builder->buildBeginPreDepends(); } versionedpackagelist NL
+ | RECOMMENDS { parser->builder->buildBeginRecommends(); }   versionedpackagelist NL
+ | SUGGESTS { parser->builder->buildBeginSuggests(); } versionedpackagelist NL
+ | REPLACES { parser->builder->buildBeginReplaces(); }       versionedpackagelist NL
+ | BUILDDEPENDS { parser->builder->buildBeginBuildDepends(); } versionedpackagelist NL
  | FILES NL SourceFilesList
- | MESSAGE STRING STRING NL	{ iniBuilder->buildMessage ($2, $3); }
+ | MESSAGE STRING STRING NL	{ parser->builder->buildMessage ($2, $3); }
  | DESCTAG mlinedesc
- | error 			{ yyerror (std::string("unrecognized line ") 
-					  + stringify(yylineno)
+ | error 			{ parser->error (std::string("unrecognized line ")
+					  + stringify(parser->lineno ())
 					  + " (do you have the latest setup?)");
 				}
  ;
 
 packagearchspec: /* empty */
- | packagearchspec STRING { iniBuilder->buildArchitecture ($2); }
+ | packagearchspec STRING { parser->builder->buildArchitecture ($2); }
  ;
  
 categories: /* empty */
- | categories STRING		{ iniBuilder->buildPackageCategory ($2); }
+ | categories STRING		{ parser->builder->buildPackageCategory ($2); }
  ;
 
 installmeta: /* empty */
- | STRING installchksum		{ iniBuilder->buildInstallSize($1); }
+ | STRING installchksum		{ parser->builder->buildInstallSize($1); }
  ;
 
 installchksum: /* empty */
- | MD5 			{ iniBuilder->buildInstallMD5 ((unsigned char *)$1);}
- | SHA512		{ iniBuilder->buildInstallSHA512 ((unsigned char *)$1);}
+ | MD5 			{ parser->builder->buildInstallMD5 ($1.digest ());}
+ | SHA512		{ parser->builder->buildInstallSHA512 ($1.digest ());}
  ;
 
 sourcechksum: /* empty */
- | MD5 			{ iniBuilder->buildSourceMD5 ((unsigned char *)$1); }
- | SHA512 		{ iniBuilder->buildSourceSHA512 ((unsigned char *)$1); }
+ | MD5 			{ parser->builder->buildSourceMD5 ($1.digest ()); }
+ | SHA512 		{ parser->builder->buildSourceSHA512 ($1.digest ()); }
  ;
 
 source /* non-empty */
- : STRING { iniBuilder->buildSourceName ($1); } versioninfo
+ : STRING { parser->builder->buildSourceName ($1); } versioninfo
  ;
 
 versioninfo: /* empty */
- | OPENBRACE STRING CLOSEBRACE { iniBuilder->buildSourceNameVersion ($2); }
+ | OPENBRACE STRING CLOSEBRACE { parser->builder->buildSourceNameVersion ($2); }
  ;
 
 mlinedesc: /* empty */
- | mlinedesc STRTOEOL NL	{ iniBuilder->buildDescription ($2); }
- | mlinedesc STRTOEOL PARAGRAPH { iniBuilder->buildDescription ($2); }
+ | mlinedesc STRTOEOL NL	{ parser->builder->buildDescription ($2); }
+ | mlinedesc STRTOEOL PARAGRAPH { parser->builder->buildDescription ($2); }
  ;
 
 packagelist /* non-empty */
- : packagelist COMMA { iniBuilder->buildPackageListAndNode(); } packageentry
- | { iniBuilder->buildPackageListAndNode(); } packageentry
+ : packagelist COMMA { parser->builder->buildPackageListAndNode(); } packageentry
+ | { parser->builder->buildPackageListAndNode(); } packageentry
  ;
 
 packageentry /* empty not allowed */
- : STRING 		  { iniBuilder->buildPackageListOrNode($1); } 
- | packageentry OR STRING { iniBuilder->buildPackageListOrNode($3); }
+ : STRING 		  { parser->builder->buildPackageListOrNode($1); } 
+ | packageentry OR STRING { parser->builder->buildPackageListOrNode($3); }
  ;
 
 versionedpackagelist /* non-empty */
- : { iniBuilder->buildPackageListAndNode(); } versionedpackageentry
- | versionedpackagelist listseparator { iniBuilder->buildPackageListAndNode(); } versionedpackageentry
+ : { parser->builder->buildPackageListAndNode(); } versionedpackageentry
+ | versionedpackagelist listseparator { parser->builder->buildPackageListAndNode(); } versionedpackageentry
  ;
 
 versionedpackagelistsp /* non-empty */
- : { iniBuilder->buildPackageListAndNode(); } versionedpackageentry
- | versionedpackagelistsp { iniBuilder->buildPackageListAndNode(); } versionedpackageentry
+ : { parser->builder->buildPackageListAndNode(); } versionedpackageentry
+ | versionedpackagelistsp { parser->builder->buildPackageListAndNode(); } versionedpackageentry
  ;
 
 
@@ -195,24 +199,36 @@ listseparator: /* empty */
  ;
  
 versionedpackageentry /* empty not allowed */
- : STRING { iniBuilder->buildPackageListOrNode($1); } versioncriteria
- | versionedpackageentry OR STRING { iniBuilder->buildPackageListOrNode($3); } versioncriteria
+ : STRING { parser->builder->buildPackageListOrNode($1); } versioncriteria
+ | versionedpackageentry OR STRING { parser->builder->buildPackageListOrNode($3); } versioncriteria
  ;
 
 versioncriteria: /* empty */
- | OPENBRACE operator STRING CLOSEBRACE { iniBuilder->buildPackageListOperatorVersion ($3); }
+ | OPENBRACE operator STRING CLOSEBRACE { parser->builder->buildPackageListOperatorVersion ($3); }
  ;
  
 operator /* non-empty */
- : EQUAL { iniBuilder->buildPackageListOperator (PackageSpecification::Equals); }
- | LT { iniBuilder->buildPackageListOperator (PackageSpecification::LessThan); }
- | GT { iniBuilder->buildPackageListOperator (PackageSpecification::MoreThan); }
- | LTEQUAL { iniBuilder->buildPackageListOperator (PackageSpecification::LessThanEquals); }
- | GTEQUAL { iniBuilder->buildPackageListOperator (PackageSpecification::MoreThanEquals); }
+ : EQUAL { parser->builder->buildPackageListOperator (PackageSpecification::Equals); }
+ | LT { parser->builder->buildPackageListOperator (PackageSpecification::LessThan); }
+ | GT { parser->builder->buildPackageListOperator (PackageSpecification::MoreThan); }
+ | LTEQUAL { parser->builder->buildPackageListOperator (PackageSpecification::LessThanEquals); }
+ | GTEQUAL { parser->builder->buildPackageListOperator (PackageSpecification::MoreThanEquals); }
  ;
 
 SourceFilesList: /* empty */
- | SourceFilesList MD5 STRING STRING { iniBuilder->buildSourceFile ((unsigned char *)$2, $3, $4);  } NL
+ | SourceFilesList MD5 STRING STRING { parser->builder->buildSourceFile ($2.digest (), $3, $4);  } NL
  ;
  
 %%
+
+void
+IniParser::error (const std::string& s)
+{
+  std::string e = name + " line " + stringify (lineno ()) + ": " + s;
+
+  if (!error_messages.empty ())
+    error_messages += "\n";
+
+  error_messages += e;
+  error_count++;
+}
@@ -0,0 +1,550 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+/* A hand-written replacement for inilex.ll, selected with
+   configure --enable-iniscan.
+
+   The whole setup.ini is read into one buffer by IniParser::parse (), which
+   is kept until the next parse with the same IniParser.  Tokens are
+   returned as (pointer, length) views into that buffer, so unlike the flex
+   lexer nothing is allocated per token; digests are decoded in place over
+   their own hex/base64url text.
+
+   The token rules, including flex's longest-match and first-rule-wins
+   tie-breaking, are the same as in inilex.ll, which remains the reference. */
+
+#include "win32.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "ini.h"
+#include "iniparse.hh"
+#include "String++.h"
+#include "IniParseFeedback.h"
+#include "sha2.h"
+#include "io_stream.h"
+
+#define READ_BUF_SIZE 65536
+/* input was consumed without producing a token, like a flex rule with an
+   empty action */
+#define NO_TOKEN (-256)
+
+const char *ini_lexer_name = "iniscan";
+
+/* character classes, see the definitions in inilex.ll */
+enum
+{
+  C_STR = 1,			/* [!a-zA-Z0-9_./:\+~-] */
+  C_HEX = 2,			/* [0-9a-f] */
+  C_B64 = 4			/* [a-zA-Z0-9_-] */
+};
+
+static const struct char_classes
+{
+  char_classes ()
+  {
+    memset (c, 0, sizeof c);
+    for (int i = 0; i < 256; ++i)
+      {
+	if (i < 128 && isalnum (i))
+	  c[i] |= C_STR | C_B64;
+	if ((i >= '0' && i <= '9') || (i >= 'a' && i <= 'f'))
+	  c[i] |= C_HEX;
+      }
+    for (const char *p = "!_./:+~-"; *p; ++p)
+      c[(unsigned char) *p] |= C_STR;
+    c['_'] |= C_B64;
+    c['-'] |= C_B64;
+  }
+  unsigned char c[256];
+} cclass;
+
+static inline bool
+is (int cls, char c)
+{
+  return cclass.c[(unsigned char) c] & cls;
+}
+
+static bool
+all (int cls, const char *p, size_t len)
+{
+  while (len--)
+    if (!is (cls, *p++))
+      return false;
+  return true;
+}
+
+/* Keywords are looked up with a perfect hash over the length, the first
+   character and the character before the ':'.  Since the hash is constexpr
+   it is used for the case labels below, so any collision between keywords
+   is a compile-time error ("duplicate case value"). */
+
+static constexpr unsigned
+kw_hash (const char *s, size_t len)
+{
+  return (len * 6 + (unsigned char) s[0] * 5
+	  + (unsigned char) s[len - 2] * 2) & 127;
+}
+
+static int
+keyword (const char *s, size_t len)
+{
+#define KEYWORD(kw, token)						\
+  case kw_hash (kw, sizeof (kw) - 1):					\
+    return (len == sizeof (kw) - 1 && !memcmp (s, kw, len)) ? token : 0
+
+  switch (kw_hash (s, len))
+    {
+      KEYWORD ("setup-timestamp:", SETUP_TIMESTAMP);
+      KEYWORD ("setup-version:", SETUP_VERSION);
+      KEYWORD ("arch:", ARCH);
+      KEYWORD ("release:", RELEASE);
+      KEYWORD ("Package:", PACKAGENAME);
+      KEYWORD ("version:", PACKAGEVERSION);
+      KEYWORD ("Version:", PACKAGEVERSION);
+      KEYWORD ("install:", INSTALL);
+      KEYWORD ("Filename:", INSTALL);
+      KEYWORD ("source:", SOURCE);
+      KEYWORD ("sdesc:", SDESC);
+      KEYWORD ("ldesc:", LDESC);
+      KEYWORD ("message:", MESSAGE);
+      KEYWORD ("Description:", DESCTAG);
+      KEYWORD ("Size:", FILESIZE);
+      KEYWORD ("MD5sum:", MD5LINE);
+      KEYWORD ("SHA512:", SHA512LINE);
+      KEYWORD ("Installed-Size:", INSTALLEDSIZE);
+      KEYWORD ("Maintainer:", MAINTAINER);
+      KEYWORD ("Architecture:", ARCHITECTURE);
+      KEYWORD ("Source:", SOURCEPACKAGE);
+      KEYWORD ("Binary:", BINARYPACKAGE);
+      KEYWORD ("Build-Depends:", BUILDDEPENDS);
+      KEYWORD ("Build-Depends-Indep:", BUILDDEPENDS);
+      KEYWORD ("Standards-Version:", STANDARDSVERSION);
+      KEYWORD ("Format:", FORMAT);
+      KEYWORD ("Directory:", DIRECTORY);
+      KEYWORD ("Files:", FILES);
+      KEYWORD ("category:", CATEGORY);
+      KEYWORD ("Section:", CATEGORY);
+      KEYWORD ("Priority:", PRIORITY);
+      KEYWORD ("requires:", REQUIRES);
+      KEYWORD ("Depends:", DEPENDS);
+      KEYWORD ("Pre-Depends:", PREDEPENDS);
+      KEYWORD ("Recommends:", RECOMMENDS);
+      KEYWORD ("Suggests:", SUGGESTS);
+      KEYWORD ("Conflicts:", CONFLICTS);
+      KEYWORD ("Replaces:", REPLACES);
+      KEYWORD ("Provides:", PROVIDES);
+      KEYWORD ("apath:", APATH);
+      KEYWORD ("ppath:", PPATH);
+      KEYWORD ("include-setup:", INCLUDE_SETUP);
+      KEYWORD ("download-url:", DOWNLOAD_URL);
+    }
+  return 0;
+#undef KEYWORD
+}
+
+static inline int
+token (YYSTYPE *lval, int t, char *s, size_t len)
+{
+  lval->s = s;
+  lval->len = len;
+  return t;
+}
+
+/* The decoded digest is shorter than its text, and each output byte is
+   only written after the input bytes it overwrites have been read. */
+
+static int
+hex_digest (YYSTYPE *lval, char *s, size_t len, int t)
+{
+  unsigned char *d = (unsigned char *) s;
+  unsigned char v1, v2;
+  size_t i, j;
+  for (i = 0, j = 0; i < len; i += 2, ++j)
+    {
+      v1 = hexnibble ((unsigned char) s[i+0]);
+      v2 = hexnibble ((unsigned char) s[i+1]);
+      d[j] = nibbled1 (v1, v2);
+    }
+  return token (lval, t, s, j);
+}
+
+static int
+b64url_digest (YYSTYPE *lval, char *s)
+{
+  /* base64url as defined in RFC4648 */
+  unsigned char *d = (unsigned char *) s;
+  unsigned char v1, v2, v3, v4;
+  int i, j;
+  for (i = 0, j = 0; i < 4*(SHA512_DIGEST_LENGTH/3); i += 4, j += 3)
+    {
+      v1 = b64url (((unsigned char) s[i+0]));
+      v2 = b64url (((unsigned char) s[i+1]));
+      v3 = b64url (((unsigned char) s[i+2]));
+      v4 = b64url (((unsigned char) s[i+3]));
+      d[j+0] = b64d1 (v1, v2, v3, v4);
+      d[j+1] = b64d2 (v1, v2, v3, v4);
+      d[j+2] = b64d3 (v1, v2, v3, v4);
+    }
+  v1 = b64url ((unsigned char) s[i+0]);
+  v2 = b64url ((unsigned char) s[i+1]);
+  v3 = 0;
+  v4 = 0;
+  d[j+0] = b64d1 (v1, v2, v3, v4);
+  return token (lval, SHA512, s, SHA512_DIGEST_LENGTH);
+}
+
+/* The per-parse state, kept in IniParser::scanner. */
+class IniScanner
+{
+public:
+  int lex (YYSTYPE *);
+  void reset ();
+  bool at_bol () const { return cur == &buffer[0] || cur[-1] == '\n'; }
+
+  /* The whole setup file; token values point into it. */
+  std::vector<char> buffer;
+  char *cur, *end;
+  int lineno;
+
+private:
+  enum
+  {
+    INITIAL,
+    descriptionstate,
+    eolstate
+  } state;
+
+  char *scan (int cls, char *p) const
+  {
+    while (p < end && is (cls, *p))
+      ++p;
+    return p;
+  }
+  void ignore_line ();
+  int lex_str (YYSTYPE *);
+  int lex_initial (YYSTYPE *);
+};
+
+void
+IniScanner::reset ()
+{
+  /* never empty, so that &buffer[0] is valid */
+  if (buffer.empty ())
+    buffer.resize (1);
+  cur = &buffer[0];
+  end = cur + buffer.size () - 1;
+  lineno = 1;
+  state = INITIAL;
+}
+
+/* Skip to just past the end of the current line. */
+void
+IniScanner::ignore_line ()
+{
+  char *nl = (char *) memchr (cur, '\n', end - cur);
+  if (nl)
+    {
+      ++lineno;
+      cur = nl + 1;
+    }
+  else
+    cur = end;
+}
+
+/* {STR} and everything made from it: digests, keywords, unknown keys,
+   EMAIL and plain STRING. */
+int
+IniScanner::lex_str (YYSTYPE *lval)
+{
+  char *s = cur;
+  char *e = scan (C_STR, s);
+
+  if (e + 1 < end && *e == '@' && is (C_STR, e[1]))
+    {
+      cur = scan (C_STR, e + 1);
+      return token (lval, EMAIL, s, cur - s);
+    }
+
+  size_t len = e - s;
+  if (len == 32 && all (C_HEX, s, len))
+    {
+      cur = e;
+      return hex_digest (lval, s, len, MD5);
+    }
+  if (len == SHA512_BLOCK_LENGTH && all (C_HEX, s, len))
+    {
+      cur = e;
+      return hex_digest (lval, s, len, SHA512);
+    }
+  if (len == 86 && all (C_B64, s, len))
+    {
+      cur = e;
+      return b64url_digest (lval, s);
+    }
+  if (len >= 2 && s[len - 1] == ':')
+    {
+      int t = keyword (s, len);
+      if (t)
+	{
+	  cur = e;
+	  if (t == DESCTAG)
+	    state = descriptionstate;
+	  else if (t == MAINTAINER)
+	    state = eolstate;
+	  return t;
+	}
+      if (at_bol ())
+	{
+	  ignore_line ();
+	  return NO_TOKEN;
+	}
+    }
+  cur = e;
+  return token (lval, STRING, s, len);
+}
+
+int
+IniScanner::lex_initial (YYSTYPE *lval)
+{
+  char c = *cur;
+  char *s;
+
+  switch (c)
+    {
+    case ' ':
+    case '\t':
+    case '\r':
+      while (cur < end && (*cur == ' ' || *cur == '\t' || *cur == '\r'))
+	++cur;
+      return NO_TOKEN;
+
+    case '\n':
+      ++cur;
+      ++lineno;
+      return NL;
+
+    case '#':
+      if (at_bol () && memchr (cur, '\n', end - cur))
+	{
+	  ignore_line ();
+	  return NO_TOKEN;
+	}
+      break;
+
+    case '"':
+      s = (char *) memchr (cur + 1, '"', end - cur - 1);
+      if (s)
+	{
+	  char *start = cur + 1;
+	  for (char *p = start; (p = (char *) memchr (p, '\n', s - p)); ++p)
+	    ++lineno;
+	  cur = s + 1;
+	  return token (lval, STRING, start, s - start);
+	}
+      break;
+
+    case '[':
+      s = scan (C_STR, cur + 1);
+      if (s > cur + 1 && s < end && *s == ']')
+	{
+	  size_t len = s + 1 - cur;
+	  const char *t = cur;
+	  cur = s + 1;
+	  if (len == 6 && !memcmp (t, "[curr]", 6))
+	    return T_CURR;
+	  if (len == 6 && !memcmp (t, "[test]", 6))
+	    return T_TEST;
+	  if (len == 5 && !memcmp (t, "[exp]", 5))
+	    return T_TEST;
+	  if (len == 6 && !memcmp (t, "[prev]", 6))
+	    return T_PREV;
+	  return T_OTHER;
+	}
+      ++cur;
+      return OPENSQUARE;
+
+    case ']':
+      ++cur;
+      return CLOSESQUARE;
+    case '(':
+      ++cur;
+      return OPENBRACE;
+    case ')':
+      ++cur;
+      return CLOSEBRACE;
+    case ',':
+      ++cur;
+      return COMMA;
+    case '|':
+      ++cur;
+      return OR;
+    case '@':
+      ++cur;
+      return AT;
+    case '=':
+      ++cur;
+      return EQUAL;
+
+    case '<':
+    case '>':
+      ++cur;
+      if (cur < end && *cur == '=')
+	{
+	  ++cur;
+	  return c == '<' ? LTEQUAL : GTEQUAL;
+	}
+      if (cur < end && *cur == c)
+	++cur;
+      return c == '<' ? LT : GT;
+
+    default:
+      if (is (C_STR, c))
+	return lex_str (lval);
+      break;
+    }
+
+  ++cur;
+  return c;
+}
+
+int
+IniScanner::lex (YYSTYPE *lval)
+{
+  while (cur < end)
+    {
+      char *nl;
+      int t;
+
+      switch (state)
+	{
+	case descriptionstate:
+	  if (*cur != '\n')
+	    break;
+	  if (cur + 1 < end && cur[1] == '\n')
+	    {
+	      while (cur < end && *cur == '\n')
+		{
+		  ++cur;
+		  ++lineno;
+		}
+	      state = INITIAL;
+	      return PARAGRAPH;
+	    }
+	  ++cur;
+	  ++lineno;
+	  return NL;
+
+	case eolstate:
+	  if (*cur != '\n')
+	    break;
+	  ++cur;
+	  ++lineno;
+	  state = INITIAL;
+	  return NL;
+
+	case INITIAL:
+	  t = lex_initial (lval);
+	  if (t != NO_TOKEN)
+	    return t;
+	  continue;
+	}
+
+      /* the rest of the line, for STRTOEOL or the Maintainer: STRING */
+      nl = (char *) memchr (cur, '\n', end - cur);
+      if (!nl)
+	nl = end;
+      t = token (lval, state == descriptionstate ? STRTOEOL : STRING,
+		 cur, nl - cur);
+      cur = nl;
+      return t;
+    }
+  return 0;
+}
+
+int
+yylex (YYSTYPE *lval, IniParser *parser)
+{
+  return ((IniScanner *) parser->scanner)->lex (lval);
+}
+
+/* IniParser, the lexer half */
+
+IniParser::IniParser (IniDBBuilder &aBuilder, IniParseFeedback &aFeedback) :
+  builder (&aBuilder), feedback (aFeedback), input (NULL),
+  scanner (new IniScanner), error_count (0)
+{
+}
+
+IniParser::~IniParser ()
+{
+  delete (IniScanner *) scanner;
+}
+
+/* Read all of stream into the scanner's buffer and start scanning it. */
+static void
+load (IniScanner *sc, io_stream *stream, IniParseFeedback &feedback)
+{
+  sc->buffer.clear ();
+  size_t used = 0;
+  if (stream->get_size ())
+    sc->buffer.reserve (stream->get_size () + 1);
+  for (;;)
+    {
+      sc->buffer.resize (used + READ_BUF_SIZE);
+      ssize_t len = stream->read (&sc->buffer[used], READ_BUF_SIZE);
+      if (len < 1)
+	break;
+      used += len;
+      feedback.progress (stream->tell (), stream->get_size ());
+    }
+  sc->buffer.resize (used + 1);
+  sc->reset ();
+}
+
+int
+IniParser::parse (io_stream *stream, const std::string& aName)
+{
+  name = aName;
+  error_count = 0;
+  error_messages.clear ();
+  load ((IniScanner *) scanner, stream, feedback);
+
+  if (yyparse (this) && !error_count)
+    error_count = 1;
+  return error_count;
+}
+
+unsigned long
+IniParser::scan (io_stream *stream, const std::string& aName)
+{
+  name = aName;
+  error_count = 0;
+  error_messages.clear ();
+  load ((IniScanner *) scanner, stream, feedback);
+
+  unsigned long tokens = 0;
+  YYSTYPE lval;
+  while (yylex (&lval, this))
+    ++tokens;
+  return tokens;
+}
+
+int
+IniParser::lineno () const
+{
+  IniScanner *sc = (IniScanner *) scanner;
+  return sc->lineno - (!!sc->at_bol ());
+}
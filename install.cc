@@ -166,6 +166,19 @@ Installer::preremoveOne (packagemeta & pkg)
     try_run_script ("/etc/preremove/", pkg.name, exts[i]);
 }
 
+/* Record what became of pkg in the installed.db journal, so that it isn't
+   lost if setup stops before installed.db is written at the end. */
+static void
+journal (packagemeta &pkg)
+{
+  packagedb db;
+  int err = db.journal (pkg);
+  if (err)
+    Log (LOG_PLAIN) << "Warning: unable to record " << pkg.name
+		    << " in the installed.db journal: " << strerror (err)
+		    << endLog;
+}
+
 void
 Installer::uninstallOne (packagemeta & pkg)
 {
@@ -173,6 +186,7 @@ Installer::uninstallOne (packagemeta & pkg)
   Progress.SetText2 (pkg.name.c_str());
   Log (LOG_PLAIN) << "Uninstalling " << pkg.name << endLog;
   pkg.uninstall ();
+  journal (pkg);
   num_uninstalls++;
 }
 
@@ -412,7 +426,10 @@ Installer::installOne (packagemeta &pkgm, const packageversion &ver,
 	       all zero bytes (the famous 46 bytes tar archives). */
 	    {
 	      if (ver.Type () == package_binary)
-		pkgm.installed = ver;
+		{
+		  pkgm.installed = ver;
+		  journal (pkgm);
+		}
 	    }
           else
             {
@@ -656,7 +673,10 @@ Installer::installOne (packagemeta &pkgm, const packageversion &ver,
   Progress.SetBar3 (df);
 
   if (ver.Type () == package_binary && !error_in_this_package)
-    pkgm.installed = ver;
+    {
+      pkgm.installed = ver;
+      journal (pkgm);
+    }
 }
 
 static void
@@ -141,6 +141,11 @@ public:
   virtual int seek (long, io_stream_seek_t) = 0;
   /* try guessing this one */
   virtual int error () = 0;
+  /* Write what has been written so far through to the disk, so that it
+   * survives a crash.  Returns 0 on success; streams that don't end up
+   * on a disk have nothing to do.
+   */
+  virtual int sync () { return 0; }
   /* hmm, yet another for the guessing books */
   virtual char *gets (char *, size_t len);
   /* what sort of stream is this?
@@ -28,6 +28,7 @@ static const char *cvsid =
 #include <stdlib.h>
 #include <errno.h>
 #include <unistd.h>
+#include <io.h>
 
 #include "io_stream_cygfile.h"
 #include "IOStreamProvider.h"
@@ -343,6 +344,17 @@ io_stream_cygfile::error ()
   return lasterr;
 }
 
+int
+io_stream_cygfile::sync ()
+{
+  if (!fp)
+    return lasterr ? lasterr : 1;
+  if (fflush (fp)
+      || !FlushFileBuffers ((HANDLE) _get_osfhandle (fileno (fp))))
+    return 1;
+  return 0;
+}
+
 int
 cygmkdir_p (path_type_t isadir, const std::string& _name, mode_t mode)
 {
@@ -43,6 +43,7 @@ public:
   virtual int seek (long where, io_stream_seek_t whence);
   /* can't guess, oh well */
   virtual int error ();
+  virtual int sync ();
   virtual int set_mtime (time_t);
   /* not relevant yet */
   virtual time_t get_mtime () { return 0; };
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#include "io_stream_tee.h"
+
+io_stream_tee::io_stream_tee (io_stream *aSource, io_stream *aCopy,
+			      io_stream *aPosition) :
+  source (aSource), copy (aCopy), position (aPosition), copy_failed (false)
+{
+  SHA512Init (&ctx);
+}
+
+io_stream_tee::~io_stream_tee ()
+{
+  delete copy;
+  delete source;
+}
+
+int
+io_stream_tee::close_copy ()
+{
+  delete copy;
+  copy = NULL;
+  return copy_failed ? 1 : 0;
+}
+
+ssize_t
+io_stream_tee::read (void *buffer, size_t len)
+{
+  ssize_t got = source->read (buffer, len);
+  if (got > 0)
+    SHA512Update (&ctx, (unsigned char const *) buffer, got);
+  if (got > 0 && copy && !copy_failed
+      && copy->write (buffer, got) != got)
+    copy_failed = true;
+  return got;
+}
+
+void
+io_stream_tee::digest (unsigned char result[SHA512_DIGEST_LENGTH])
+{
+  SHA512Final (result, &ctx);
+}
+
+long
+io_stream_tee::tell ()
+{
+  return position ? position->tell () : source->tell ();
+}
+
+size_t
+io_stream_tee::get_size ()
+{
+  return position ? position->get_size () : source->get_size ();
+}
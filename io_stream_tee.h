@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#ifndef SETUP_IO_STREAM_TEE_H
+#define SETUP_IO_STREAM_TEE_H
+
+#include "io_stream.h"
+#include "sha2.h"
+
+/* A read-only stream that passes on whatever is read from another stream
+ * and writes a copy of it to a second one on the way.  This lets a
+ * decompressed setup.ini be parsed and saved in the same pass, without
+ * inflating it into memory first.
+ *
+ * A decompressor can't tell how far it has got, so tell () and get_size ()
+ * may be taken from a third stream instead - the compressed stream the
+ * decompressor is reading - which gives a progress bar based on the
+ * compressed bytes consumed.
+ *
+ * The SHA-512 digest of everything read is kept on the way, too.
+ */
+class io_stream_tee : public io_stream
+{
+public:
+  /* source and copy are owned by the tee from now on; copy may be NULL.
+   * position, if given, must outlive the tee and is not deleted by it.
+   */
+  io_stream_tee (io_stream *source, io_stream *copy,
+		 io_stream *position = NULL);
+  virtual ~io_stream_tee ();
+
+  /* Close the copy.  Returns 0 if everything read so far was written to
+   * it; no further copying is done after this.
+   */
+  int close_copy ();
+  /* The digest of everything read so far; may only be called once. */
+  void digest (unsigned char result[SHA512_DIGEST_LENGTH]);
+
+  virtual int set_mtime (time_t) { return 1; }
+  virtual time_t get_mtime () { return source->get_mtime (); }
+  virtual mode_t get_mode () { return source->get_mode (); }
+  virtual size_t get_size ();
+  virtual ssize_t read (void *buffer, size_t len);
+  virtual ssize_t write (const void *, size_t) { return -1; }
+  virtual ssize_t peek (void *buffer, size_t len)
+    { return source->peek (buffer, len); }
+  virtual long tell ();
+  virtual int seek (long, io_stream_seek_t) { return -1; }
+  virtual int error () { return source->error (); }
+private:
+  io_stream *source;
+  io_stream *copy;
+  io_stream *position;
+  bool copy_failed;
+  SHA2_CTX ctx;
+};
+
+#endif /* SETUP_IO_STREAM_TEE_H */
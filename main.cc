@@ -63,6 +63,7 @@ static const char *cvsid =
 #include "threebar.h"
 #include "desktop.h"
 #include "postinstallresults.h"
+#include "query.h"
 
 #include "getopt++/GetOption.h"
 #include "getopt++/BoolOption.h"
@@ -98,6 +99,7 @@ static BoolOption PackageManagerOption (false, 'M', "package-manager", "Semi-att
 static BoolOption NoAdminOption (false, 'B', "no-admin", "Do not check for and enforce running as Administrator");
 static BoolOption WaitOption (false, 'W', "wait", "When elevating, wait for elevated child process");
 static BoolOption HelpOption (false, 'h', "help", "print help");
+static StringOption QueryOption ("", 'Q', "query", "Print what installed packages depend on or need, why they are installed, or what installing packages pulls in, as 'rdepends|depends|why|pulls:package[,package...]', and exit", false);
 static StringOption SetupBaseNameOpt ("setup", 'i', "ini-basename", "Use a different basename, e.g. \"foo\", instead of \"setup\"", false);
 std::string SetupBaseName;
 
@@ -262,7 +264,8 @@ WinMain (HINSTANCE h,
     unattended_mode = PackageManagerOption ? chooseronly
 			: (UnattendedOption ? unattended : attended);
 
-    if (unattended_mode || help_option)
+    bool query = ((string) QueryOption).size ();
+    if (unattended_mode || help_option || query)
       set_cout ();
 
     SetupBaseName = SetupBaseNameOpt;
@@ -273,7 +276,7 @@ WinMain (HINSTANCE h,
        supposed to elevate. */
     nt_sec.initialiseWellKnownSIDs ();
     /* Check if we have to elevate. */
-    bool elevate = !help_option && OSMajorVersion () >= 6
+    bool elevate = !help_option && !query && OSMajorVersion () >= 6
 		   && !NoAdminOption && !nt_sec.isRunAsAdmin ();
 
     /* Start logging only if we don't elevate.  Same for setting default
@@ -281,8 +284,8 @@ WinMain (HINSTANCE h,
     LogSingleton::SetInstance (*LogFile::createLogFile ());
     const char *sep = isdirsep (local_dir[local_dir.size () - 1])
 				? "" : "\\";
-    /* Don't create log files for help output only. */
-    if (!elevate && !help_option)
+    /* Don't create log files for help output or queries only. */
+    if (!elevate && !help_option && !query)
       {
 	Logger ().setFile (LOG_BABBLE, local_dir + sep + "setup.log.full",
 			   false);
@@ -308,6 +311,11 @@ WinMain (HINSTANCE h,
 	Log (LOG_PLAIN) << endLog;
 	Logger ().exit (invalid_option ? 1 : 0, false);
       }
+    else if (query)
+      {
+	UserSettings Settings (local_dir);
+	Logger ().exit (do_query (QueryOption), false);
+      }
     else if (elevate)
       {
 	char exe_path[MAX_PATH];
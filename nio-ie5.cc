@@ -42,8 +42,11 @@ NetIO (_url)
   if (internet == 0)
     {
       InternetAttemptConnect (0);
-      internet = InternetOpen ("Cygwin Setup", INTERNET_OPEN_TYPE_PRECONFIG,
-			       NULL, NULL, 0);
+      HINTERNET h = InternetOpen ("Cygwin Setup", INTERNET_OPEN_TYPE_PRECONFIG,
+				  NULL, NULL, 0);
+      /* the setup files of several mirrors are fetched at once */
+      if (InterlockedCompareExchangePointer (&internet, h, 0) != 0)
+	InternetCloseHandle (h);
     }
 
   DWORD flags =
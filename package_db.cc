@@ -24,6 +24,8 @@ static const char *cvsid =
 #endif
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
 #include <unistd.h>
 #include <strings.h>
 #include <algorithm>
@@ -47,141 +49,390 @@ static const char *cvsid =
 
 using namespace std;
 
+/* The installed.db snapshot, the file that replaces it while it is
+   rewritten, and the journal of what was installed or removed since it was
+   written.  Each journal record is one line:
+     'I packagename version flags hash' - installed, as in INSTALLED.DB 3
+     'R packagename hash'               - removed
+   where hash is the FNV-1a hash of the rest of the line, in hex, so that a
+   record torn by a crash is recognised and it and anything after it are
+   ignored.  Replaying a record twice does no harm. */
+static char const *installedDB = "cygfile:///etc/setup/installed.db";
+static char const *installedDBNew = "cygfile:///etc/setup/installed.db.new";
+static char const *installedDBJournal =
+  "cygfile:///etc/setup/installed.db.journal";
+
+static uint32_t
+journalHash (const char *record, size_t len)
+{
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; ++i)
+    {
+      h ^= (unsigned char) record[i];
+      h *= 16777619u;
+    }
+  return h;
+}
+
+/* Read all that is left of s into contents. */
+static void
+readAll (io_stream *s, std::string &contents)
+{
+  size_t size = s->get_size ();
+  contents.reserve (size + 1);
+  char buffer[65536];
+  ssize_t count;
+  while ((count = s->read (buffer, sizeof (buffer))) > 0)
+    contents.append (buffer, count);
+}
+
+/* A part of a file that has been read into memory. */
+struct TextSpan
+{
+  const char *begin, *end;
+  size_t size () const { return end - begin; }
+  std::string str () const { return std::string (begin, end); }
+};
+
+/* Split the next line off text, without its line ending. */
+static bool
+nextLine (TextSpan &text, TextSpan &line)
+{
+  if (text.begin == text.end)
+    return false;
+  const char *eol = (const char *) memchr (text.begin, '\n', text.size ());
+  line.begin = text.begin;
+  line.end = eol ? eol : text.end;
+  text.begin = eol ? eol + 1 : text.end;
+  if (line.end > line.begin && line.end[-1] == '\r')
+    --line.end;
+  return true;
+}
+
+/* Split the next blank-separated word off line; it is empty at the end. */
+static TextSpan
+nextWord (TextSpan &line)
+{
+  while (line.begin != line.end && isspace ((unsigned char) *line.begin))
+    ++line.begin;
+  TextSpan word = line;
+  while (line.begin != line.end && !isspace ((unsigned char) *line.begin))
+    ++line.begin;
+  word.end = line.begin;
+  return word;
+}
+
+static bool
+isWord (TextSpan const &word, const char *s)
+{
+  size_t len = strlen (s);
+  return word.size () == len && !strncasecmp (word.begin, s, len);
+}
+
+/* The leading decimal number of word, like sscanf's %d. */
+static int
+number (TextSpan const &word)
+{
+  const char *p = word.begin;
+  bool negative = p != word.end && *p == '-';
+  if (negative)
+    ++p;
+  int n = 0;
+  for (; p != word.end && isdigit ((unsigned char) *p); ++p)
+    n = n * 10 + (*p - '0');
+  return negative ? -n : n;
+}
+
+/* Read the snapshot into entries.  Returns its version, or 0 if there is
+   none.  If the snapshot was being replaced when setup was interrupted,
+   the replacement is complete (see flush ()), so it is read instead. */
+static int
+readInstalledDB (packagedb::installedEntries &entries)
+{
+  io_stream *db = io_stream::open (installedDB, "rb", 0);
+  if (!db)
+    db = io_stream::open (installedDBNew, "rb", 0);
+  if (!db)
+    return 0;
+  std::string contents;
+  readAll (db, contents);
+  delete db;
+
+  TextSpan text = { contents.data (), contents.data () + contents.size () };
+  TextSpan line;
+  if (!nextLine (text, line))
+    return 0;
+  /* Look for header line (absent in version 1) */
+  int dbver = 1;
+  TextSpan header = line;
+  if (isWord (nextWord (header), "INSTALLED.DB"))
+    {
+      dbver = number (nextWord (header));
+      if (!nextLine (text, line))
+	line.begin = line.end;
+    }
+  Log (LOG_BABBLE) << "INSTALLED.DB version " << dbver << endLog;
+  if (dbver < 1 || dbver > 3)
+    return dbver;
+
+  do
+    {
+      TextSpan pkgname = nextWord (line), inst = nextWord (line),
+	flags = nextWord (line);
+      if (!flags.size ())
+	continue;
+      packagedb::installedEntry &entry = entries[pkgname.str ()];
+      entry.inst = inst.str ();
+      entry.flags = dbver == 3 ? number (flags) : 0;
+    }
+  while (nextLine (text, line));
+  return dbver;
+}
+
+/* The hash at the end of a journal record, and the record before it. */
+static bool
+recordHash (TextSpan &record, uint32_t &hash)
+{
+  const char *space = record.end;
+  while (space != record.begin && space[-1] != ' ')
+    --space;
+  if (space == record.begin || space == record.end
+      || record.end - space > 8)
+    return false;
+  hash = 0;
+  for (const char *p = space; p != record.end; ++p)
+    {
+      int digit = isdigit ((unsigned char) *p) ? *p - '0'
+	: isxdigit ((unsigned char) *p) ? tolower (*p) - 'a' + 10 : -1;
+      if (digit < 0)
+	return false;
+      hash = hash << 4 | digit;
+    }
+  record.end = space - 1;
+  return true;
+}
+
+/* Apply the journal to entries.  Returns the number of records, and sets
+   torn if a record that doesn't check out stopped the replay short. */
+static unsigned int
+replayJournal (packagedb::installedEntries &entries, bool &torn)
+{
+  torn = false;
+  io_stream *journal = io_stream::open (installedDBJournal, "rb", 0);
+  if (!journal)
+    return 0;
+  std::string contents;
+  readAll (journal, contents);
+  delete journal;
+
+  TextSpan text = { contents.data (), contents.data () + contents.size () };
+  TextSpan line;
+  unsigned int records = 0;
+  while (nextLine (text, line))
+    {
+      uint32_t hash;
+      if (!recordHash (line, hash)
+	  || hash != journalHash (line.begin, line.size ()))
+	{
+	  Log (LOG_PLAIN) << "Ignoring the end of " << installedDBJournal
+			  << " from record " << records + 1 << endLog;
+	  torn = true;
+	  break;
+	}
+      TextSpan op = nextWord (line), pkgname = nextWord (line),
+	inst = nextWord (line), flags = nextWord (line);
+      if (isWord (op, "I") && flags.size ())
+	{
+	  packagedb::installedEntry &entry = entries[pkgname.str ()];
+	  entry.inst = inst.str ();
+	  entry.flags = number (flags);
+	}
+      else if (isWord (op, "R") && pkgname.size ())
+	entries.erase (pkgname.str ());
+      ++records;
+    }
+  return records;
+}
+
+/* The version in inst, the notional filename of the installed.db entry for
+   the package name.  flush () writes name-version.tar.bz2, which is split
+   where the name ends; anything else is left to parse_filename (). */
+static std::string
+installedVersion (const std::string &name, const std::string &inst)
+{
+  size_t ext = find_tar_ext (inst.c_str ());
+  if (ext > name.size () + 1 && inst[name.size ()] == '-'
+      && !inst.compare (0, name.size (), name))
+    return inst.substr (name.size () + 1, ext - name.size () - 1);
+  fileparse f;
+  if (!parse_filename (inst, f))
+    return std::string ();
+  return f.ver;
+}
+
 packagedb::packagedb ()
 {
-  io_stream *db = 0;
   if (!installeddbread)
     {
       /* no parameters. Read in the local installation database. */
-      db = io_stream::open ("cygfile:///etc/setup/installed.db", "rt", 0);
       installeddbread = 1;
-      if (!db)
+      installedEntries entries;
+      int dbver = readInstalledDB (entries);
+      if (dbver > 3)
+	fatal(NULL, IDS_INSTALLEDB_VERSION);
+      snapshotSize = entries.size ();
+      journalled = replayJournal (entries, journalTorn);
+      /* the journal is only ever written in the current format */
+      if (journalled && !dbver)
+	dbver = 3;
+      if (!dbver)
 	return;
-      char line[1000], pkgname[1000];
 
-      if (db->gets (line, 1000))
+      for (installedEntries::iterator i = entries.begin ();
+	   i != entries.end (); ++i)
 	{
-	  /* Look for header line (absent in version 1) */
-	  int instsz;
-	  int dbver;
-	  sscanf (line, "%s %d", pkgname, &instsz);
-	  if (!strcasecmp (pkgname, "INSTALLED.DB"))
-	    dbver = instsz;
-	  else
-	    dbver = 1;
-	  delete db;
-	  db = 0;
-
-	  Log (LOG_BABBLE) << "INSTALLED.DB version " << dbver << endLog;
+	  std::string version = installedVersion (i->first, i->second.inst);
+	  if (version.empty ())
+	    continue;
 
-	  if (dbver <= 3)
+	  packagemeta *pkg = findBinary (PackageSpecification(i->first));
+	  if (!pkg)
 	    {
-	      char inst[1000];
-
-	      db =
-		io_stream::open ("cygfile:///etc/setup/installed.db", "rt", 0);
-
-	      // skip over already-parsed header line
-	      if (dbver >= 2)
-		db->gets (line, 1000);
-
-	      while (db->gets (line, 1000))
-		{
-		  int parseable;
-		  int user_picked = 0;
-		  pkgname[0] = '\0';
-		  inst[0] = '\0';
-
-		  int res = sscanf (line, "%s %s %d", pkgname, inst, &user_picked);
-
-		  if (res < 3 || pkgname[0] == '\0' || inst[0] == '\0')
-			continue;
-
-		  fileparse f;
-		  parseable = parse_filename (inst, f);
-		  if (!parseable)
-		    continue;
-
-		  packagemeta *pkg = findBinary (PackageSpecification(pkgname));
-		  if (!pkg)
-		    {
-		      pkg = new packagemeta (pkgname);
-		      packages.insert (packagedb::packagecollection::value_type(pkgname, pkg));
-		    }
-
-		  packageversion binary = 
-		    cygpackage::createInstance (pkgname, f.ver,
-						package_installed,
-						package_binary);
-
-		  pkg->add_version (binary);
-		  pkg->set_installed (binary);
-		  pkg->desired = pkg->installed;
-
-		  if (dbver == 3)
-		    pkg->user_picked = (user_picked & 1);
-		}
-	      delete db;
-	      db = 0;
-	    }
-	  else
-	    {
-              fatal(NULL, IDS_INSTALLEDB_VERSION);
+	      pkg = new packagemeta (i->first);
+	      packages.insert (pkg);
 	    }
 
-	  installeddbver = dbver;
+	  packageversion binary = 
+	    cygpackage::createInstance (i->first, version,
+					package_installed,
+					package_binary);
+
+	  pkg->add_version (binary);
+	  pkg->set_installed (binary);
+	  pkg->desired = pkg->installed;
+
+	  if (dbver == 3)
+	    pkg->user_picked = (i->second.flags & 1);
 	}
+
+      installeddbver = dbver;
     }
 }
 
+/*
+  In INSTALLED.DB 3, lines are: 'packagename version flags', where
+  version is encoded in a notional filename for backwards
+  compatibility, and the only currently defined flag is user-picked
+  (bit 0).
+*/
+static std::string
+installedLine (packagemeta &pkgm)
+{
+  return pkgm.name + " " +
+    pkgm.name + "-" + std::string(pkgm.installed.Canonical_version()) + ".tar.bz2 " +
+    (pkgm.user_picked ? "1" : "0");
+}
+
 int
 packagedb::flush ()
 {
   /* naive approach - just dump the lot */
-  char const *odbn = "cygfile:///etc/setup/installed.db";
-  char const *ndbn = "cygfile:///etc/setup/installed.db.new";
-
-  io_stream::mkpath_p (PATH_TO_FILE, ndbn, 0755);
+  io_stream::mkpath_p (PATH_TO_FILE, installedDBNew, 0755);
 
-  io_stream *ndb = io_stream::open (ndbn, "wb", 0644);
+  io_stream *ndb = io_stream::open (installedDBNew, "wb", 0644);
 
   // XXX if this failed, try removing any existing .new database?
   if (!ndb)
     return errno ? errno : 1;
 
   ndb->write ("INSTALLED.DB 3\n", strlen ("INSTALLED.DB 3\n"));
+  size_t lines = 0;
   for (packagedb::packagecollection::iterator i = packages.begin ();
        i != packages.end (); ++i)
     {
       packagemeta & pkgm = *(i->second);
       if (pkgm.installed)
 	{
-	  /*
-	    In INSTALLED.DB 3, lines are: 'packagename version flags', where
-	    version is encoded in a notional filename for backwards
-	    compatibility, and the only currently defined flag is user-picked
-	    (bit 0).
-	  */
-	  std::string line;
-	  line = pkgm.name + " " +
-	    pkgm.name + "-" + std::string(pkgm.installed.Canonical_version()) + ".tar.bz2 " +
-	    (pkgm.user_picked ? "1" : "0") + "\n";
+	  std::string line = installedLine (pkgm) + "\n";
 	  ndb->write (line.c_str(), line.size());
+	  ++lines;
 	}
     }
 
+  /* The new snapshot must be complete on disk before the old one goes,
+     as it is read in its place if setup stops in between. */
+  int err = ndb->sync ();
   delete ndb;
+  if (err)
+    return errno ? errno : 1;
+
+  io_stream::remove (installedDB);
+
+  if (io_stream::move (installedDBNew, installedDB))
+    return errno ? errno : 1;
 
-  io_stream::remove (odbn);
+  /* everything in the journal is in the snapshot now */
+  delete journalFile;
+  journalFile = NULL;
+  io_stream::remove (installedDBJournal);
+  journalled = 0;
+  journalTorn = false;
+  snapshotSize = lines;
+  return 0;
+}
 
-  if (io_stream::move (ndbn, odbn))
+int
+packagedb::journal (packagemeta &pkgm)
+{
+  /* Compacting costs a write of the whole snapshot, so doing it once the
+     journal has grown by a fraction of that keeps the cost per record
+     bounded, as well as the length of the journal.  Records appended
+     after a torn one would never be replayed, so a journal that ends in
+     one is compacted first. */
+  if (journalTorn || journalled >= 64 + snapshotSize / 4)
+    return flush ();
+
+  if (!journalFile)
+    {
+      io_stream::mkpath_p (PATH_TO_FILE, installedDBJournal, 0755);
+      journalFile = io_stream::open (installedDBJournal, "ab", 0644);
+      if (!journalFile)
+	return errno ? errno : 1;
+    }
+  std::string record = pkgm.installed ? "I " + installedLine (pkgm)
+    : "R " + pkgm.name;
+  char hash[16];
+  sprintf (hash, " %08x\n", journalHash (record.c_str (), record.size ()));
+  record += hash;
+  if (journalFile->write (record.c_str (), record.size ())
+      != (ssize_t) record.size ()
+      || journalFile->sync ())
     return errno ? errno : 1;
+  ++journalled;
   return 0;
 }
 
+/* Add the depends of every version to the graph, and index what they
+   provide, now that all packages are known.  Done afresh each time: since
+   the last time depends may have been merged again and packages added
+   that the targets linked then couldn't find. */
+void
+packagedb::link ()
+{
+  graph.clear ();
+  dependents.clear ();
+  providers.build ();
+  for (PackageCollection::id_type i = 0; i < packages.ids (); ++i)
+    if (packages[i])
+      for (set<packageversion>::iterator v = packages[i]->versions.begin ();
+	   v != packages[i]->versions.end (); ++v)
+	const_cast<packageversion &> (*v).dependencyNode ();
+}
+
 void
 packagedb::upgrade()
 {
+  link ();
   if (installeddbver < 3)
     {
       /* Guess which packages were user_picked.  This has to take place after
@@ -194,44 +445,73 @@ packagedb::upgrade()
 packagemeta *
 packagedb::findBinary (PackageSpecification const &spec) const
 {
-  packagedb::packagecollection::iterator n = packages.find(spec.packageName());
-  if (n != packages.end())
-    {
-      packagemeta & pkgm = *(n->second);
-      for (set<packageversion>::iterator i=pkgm.versions.begin();
-	  i != pkgm.versions.end(); ++i)
-	if (spec.satisfies (*i))
-	  return &pkgm;
-    }
+  packagemeta *n = packages.find (spec.packageName ());
+  if (n && spec.satisfyingVersions (n->versions))
+    return n;
   return NULL;
 }
 
 packagemeta *
 packagedb::findSource (PackageSpecification const &spec) const
 {
-  packagedb::packagecollection::iterator n = sourcePackages.find(spec.packageName());
-  if (n != sourcePackages.end())
-    {
-      packagemeta & pkgm = *(n->second);
-      for (set<packageversion>::iterator i = pkgm.versions.begin();
-	   i != pkgm.versions.end(); ++i)
-	if (spec.satisfies (*i))
-	  return &pkgm;
-    }
+  packagemeta *n = sourcePackages.find (spec.packageName ());
+  if (n && spec.satisfyingVersions (n->versions))
+    return n;
   return NULL;
 }
 
+void
+packagedb::clear (bool reread)
+{
+  /* dropped first, so the packages needn't be taken off them one by one */
+  categories.clear ();
+  for (PackageCollection::id_type i = 0; i < packages.ids (); ++i)
+    delete packages[i];
+  for (PackageCollection::id_type i = 0; i < sourcePackages.ids (); ++i)
+    delete sourcePackages[i];
+  packages.clear ();
+  sourcePackages.clear ();
+  dependencyOrderedPackages.clear ();
+  dependencyLevels.clear ();
+  graph.clear ();
+  providers.clear ();
+  dependents.clear ();
+  dependencies.clear ();
+  descriptions.clear ();
+  descriptionSources.clear ();
+  /* the package ids will be given out again */
+  ++versionsGeneration;
+  delete journalFile;
+  journalFile = NULL;
+  journalled = 0;
+  journalTorn = false;
+  snapshotSize = 0;
+  installeddbread = !reread;
+}
+
 /* static members */
 
 int packagedb::installeddbread = 0;
 int packagedb::installeddbver = 0;
+io_stream *packagedb::journalFile = NULL;
+unsigned int packagedb::journalled = 0;
+bool packagedb::journalTorn = false;
+size_t packagedb::snapshotSize = 0;
 packagedb::packagecollection packagedb::packages;
 packagedb::categoriesType packagedb::categories;
+Arena packagedb::dependencies;
+Arena packagedb::descriptions (256 * 1024);
+std::list<std::vector<unsigned char> > packagedb::descriptionSources;
+DependencyGraph packagedb::graph (packagedb::packages);
+ProviderIndex packagedb::providers (packagedb::packages);
+DependentIndex packagedb::dependents (packagedb::packages, packagedb::graph,
+				      packagedb::providers);
 packagedb::packagecollection packagedb::sourcePackages;
 PackageDBActions packagedb::task = PackageDB_Install;
+unsigned int packagedb::visitGeneration = 1;
+unsigned int packagedb::versionsGeneration = 1;
 std::vector <packagemeta *> packagedb::dependencyOrderedPackages;
-
-#include <stack>
+std::vector <unsigned int> packagedb::dependencyLevels;
 
 class
 ConnectedLoopFinder
@@ -240,29 +520,42 @@ public:
   ConnectedLoopFinder(void);
   void doIt(void);
 private:
-  size_t visit (packagemeta *pkg);
+  void visit (PackageCollection::id_type id);
+  void enter (PackageCollection::id_type id);
+  void leave (PackageCollection::id_type id);
 
   packagedb db;
   size_t visited;
-
-  typedef std::map<packagemeta *, size_t> visitMap;
-  visitMap visitOrder;
-  std::stack<packagemeta *> nodesInStronglyConnectedComponent;
+  /* visitOrder of the packages in a finished component */
+  size_t finished;
+
+  /* by package id: when it was first reached, the earliest package
+     reachable from it that is still on nodesInStronglyConnectedComponent,
+     and the dependency level worked out for it so far */
+  std::vector<size_t> visitOrder;
+  std::vector<size_t> lowLink;
+  std::vector<unsigned int> level;
+  std::vector<PackageCollection::id_type> nodesInStronglyConnectedComponent;
+
+  /* the packages being visited, and the next and end of their clauses
+     to follow */
+  struct Frame
+  {
+    PackageCollection::id_type id;
+    DependencyGraph::index_type clause, end;
+  };
+  std::vector<Frame> frames;
 };
 
-ConnectedLoopFinder::ConnectedLoopFinder() : visited(0)
+ConnectedLoopFinder::ConnectedLoopFinder() : visited(0),
+  finished ((size_t) -1), visitOrder (db.packages.ids (), 0),
+  lowLink (db.packages.ids (), 0), level (db.packages.ids (), 0)
 {
-  for (packagedb::packagecollection::iterator i = db.packages.begin ();
-       i != db.packages.end (); ++i)
-    visitOrder.insert(visitMap::value_type(i->second, 0));
 }
 
 void
 ConnectedLoopFinder::doIt()
 {
-  /* XXX this could be done useing a class to hold both the visitedInIteration and the package
-   * meta reference. Then we could use a range, not an int loop. 
-   */
   /* We have to expect dependency loops.  These loops break the topological
      sorting which would be a result of the below algorithm looking for
      strongly connected components in a directed graph.  Unfortunately it's
@@ -273,8 +566,8 @@ ConnectedLoopFinder::doIt()
        i != db.packages.end (); ++i)
     {
       packagemeta &pkg (*(i->second));
-      if (pkg.installed && !visitOrder[&pkg])
-	visit (&pkg);
+      if (pkg.installed && !visitOrder[i.id ()])
+	visit (i.id ());
     }
   Log (LOG_BABBLE) << "Visited: " << visited << " nodes out of "
                    << db.packages.size() << " while creating dependency order."
@@ -282,13 +575,12 @@ ConnectedLoopFinder::doIt()
 }
 
 static bool
-checkForInstalled (PackageSpecification *spec)
+checkForInstalled (DependencyGraph::index_type alternative)
 {
-  packagedb db;
-  packagemeta *required = db.findBinary (*spec);
+  packagemeta *required = packagedb::graph.package (alternative);
   if (!required)
     return false;
-  if (spec->satisfies (required->installed)
+  if (packagedb::graph.spec (alternative)->satisfies (required->installed)
       && required->desired == required->installed )
     /* done, found a satisfactory installed version that will remain
        installed */
@@ -296,69 +588,119 @@ checkForInstalled (PackageSpecification *spec)
   return false;
 }
 
-size_t
-ConnectedLoopFinder::visit(packagemeta *nodeToVisit)
+/* The package of the first alternative of clause that is installed and
+   stays so, or failing that of the first installed version providing
+   one; npos if there is none. */
+static PackageCollection::id_type
+installedAlternative (DependencyGraph::index_type clause)
 {
-  if (!nodeToVisit->installed)
-    /* Can't visit this node, and it is not less than any visted node */
-    return db.packages.size() + 1;
-
-  if (visitOrder[nodeToVisit])
-    return visitOrder[nodeToVisit];
+  DependencyGraph &graph = packagedb::graph;
+  for (DependencyGraph::index_type i = graph.alternativeBegin (clause);
+       i != graph.alternativeEnd (clause); ++i)
+    if (checkForInstalled (i))
+      return graph.target (i);
+  if (packagedb::providers.empty ())
+    return PackageCollection::npos;
+  for (DependencyGraph::index_type i = graph.alternativeBegin (clause);
+       i != graph.alternativeEnd (clause); ++i)
+    {
+      ProviderIndex::range r = packagedb::providers.find (*graph.spec (i));
+      for (ProviderIndex::const_iterator p = r.first; p != r.second; ++p)
+	{
+	  packagemeta *pkg = packagedb::packages[p->id];
+	  if (pkg && p->version == pkg->installed
+	      && pkg->desired == pkg->installed
+	      && graph.spec (i)->satisfiedBy (*p->provided))
+	    return p->id;
+	}
+    }
+  return PackageCollection::npos;
+}
 
+void
+ConnectedLoopFinder::enter (PackageCollection::id_type id)
+{
   ++visited;
-  visitOrder[nodeToVisit] = visited;
+  visitOrder[id] = lowLink[id] = visited;
 
 #if DEBUG
-  Log (LOG_PLAIN) << "visited '" << nodeToVisit->name << "', assigned id " << visited << endLog;
+  Log (LOG_PLAIN) << "visited '" << db.packages[id]->name << "', assigned id " << visited << endLog;
 #endif
 
-  size_t minimumVisitId = visited;
-  nodesInStronglyConnectedComponent.push(nodeToVisit);
+  nodesInStronglyConnectedComponent.push_back (id);
+  DependencyGraph::index_type node = db.packages[id]->installed.dependencyNode ();
+  Frame frame = { id, db.graph.clauseBegin (node), db.graph.clauseEnd (node) };
+  frames.push_back (frame);
+}
+
+/* All that id needs has been visited.  If nothing it reaches was reached
+   before it, it is the first of a strongly connected component, which is
+   everything pushed since: they go into the order together, at one more
+   than the highest level of what they need outside the component. */
+void
+ConnectedLoopFinder::leave (PackageCollection::id_type id)
+{
+  if (lowLink[id] != visitOrder[id])
+    return;
+  size_t first = nodesInStronglyConnectedComponent.size ();
+  unsigned int componentLevel = 0;
+  do
+    componentLevel = std::max (componentLevel,
+			       level[nodesInStronglyConnectedComponent[--first]]);
+  while (nodesInStronglyConnectedComponent[first] != id);
+  PackageCollection::id_type popped;
+  do {
+    popped = nodesInStronglyConnectedComponent.back ();
+    nodesInStronglyConnectedComponent.pop_back ();
+    db.dependencyOrderedPackages.push_back (db.packages[popped]);
+    db.dependencyLevels.push_back (componentLevel);
+    level[popped] = componentLevel;
+    /* mark as displayed in a connected component */
+    visitOrder[popped] = finished;
+  } while (popped != id);
+}
 
-  vector <vector <PackageSpecification *> *>::const_iterator dp = nodeToVisit->installed.depends()->begin();
-  /* walk through each and clause (a link in the graph) */
-  while (dp != nodeToVisit->installed.depends()->end())
+/* Tarjan's algorithm, with an explicit stack so that long dependency
+   chains can't overflow the real one. */
+void
+ConnectedLoopFinder::visit(PackageCollection::id_type root)
+{
+  enter (root);
+  while (!frames.empty ())
     {
-      /* check each or clause for an installed match */
-      vector <PackageSpecification *>::const_iterator i = find_if ((*dp)->begin(), (*dp)->end(), checkForInstalled);
-      if (i != (*dp)->end())
+      PackageCollection::id_type id = frames.back ().id;
+      /* walk through each and clause (a link in the graph) */
+      if (frames.back ().clause != frames.back ().end)
 	{
-	  /* we found an installed ok package */
-	  /* visit it if needed */
-	  /* UGLY. Need to refactor. iterators in the outer would help as we could simply
-	   * vist the iterator
-	   */
-	  const packagedb::packagecollection::iterator n = db.packages.find((*i)->packageName());
-
-	  if (n == db.packages.end())
-	     Log (LOG_PLAIN) << "Search for package '" << (*i)->packageName() << "' failed." << endLog;
-	   else
-	   {
-	       packagemeta *nodeJustVisited = n->second;
-	       minimumVisitId = std::min (minimumVisitId, visit (nodeJustVisited));
-	   }
-	  /* next and clause */
-	  ++dp;
+	  /* check each or clause for an installed match, and visit it if
+	     needed; not installed or not available we ignore */
+	  PackageCollection::id_type next =
+	    installedAlternative (frames.back ().clause++);
+	  if (next == PackageCollection::npos
+	      || !db.packages[next]->installed)
+	    continue;
+	  if (!visitOrder[next])
+	    enter (next);
+	  else if (visitOrder[next] == finished)
+	    level[id] = std::max (level[id], level[next] + 1);
+	  else
+	    lowLink[id] = std::min (lowLink[id], visitOrder[next]);
 	  continue;
 	}
-	/* not installed or not available we ignore */
-      ++dp;
-    }
-
-  if (minimumVisitId == visitOrder[nodeToVisit])
-  {
-    packagemeta *popped;
-    do {
-      popped = nodesInStronglyConnectedComponent.top();
-      nodesInStronglyConnectedComponent.pop();
-      db.dependencyOrderedPackages.push_back(popped);
-      /* mark as displayed in a connected component */
-      visitOrder[popped] = db.packages.size() + 2;
-    } while (popped != nodeToVisit);
-  }
 
-  return minimumVisitId;
+      frames.pop_back ();
+      leave (id);
+      if (frames.empty ())
+	break;
+      PackageCollection::id_type parent = frames.back ().id;
+      if (visitOrder[id] == finished)
+	level[parent] = std::max (level[parent], level[id] + 1);
+      else
+	{
+	  lowLink[parent] = std::min (lowLink[parent], lowLink[id]);
+	  level[parent] = std::max (level[parent], level[id]);
+	}
+    }
 }
 
 PackageDBConnectedIterator
@@ -368,17 +710,28 @@ packagedb::connectedBegin()
     {
       ConnectedLoopFinder doMe;
       doMe.doIt();
-      std::string s = "Dependency order of packages: ";
-      
+      std::ostream &s = Log (LOG_BABBLE);
+      s << "Dependency order of packages: ";
       for (std::vector<packagemeta *>::iterator i =
            dependencyOrderedPackages.begin();
            i != dependencyOrderedPackages.end(); ++i)
-        s = s + (*i)->name + " ";
-      Log (LOG_BABBLE) << s << endLog;
+        s << (*i)->name << " ";
+      s << endLog;
+      Log (LOG_BABBLE) << "Dependency levels: "
+		       << (dependencyLevels.empty () ? 0
+			   : *std::max_element (dependencyLevels.begin (),
+						dependencyLevels.end ()) + 1)
+		       << endLog;
     }
   return dependencyOrderedPackages.begin();
 }
 
+unsigned int
+packagedb::connectedLevel (PackageDBConnectedIterator i)
+{
+  return dependencyLevels[i - dependencyOrderedPackages.begin ()];
+}
+
 PackageDBConnectedIterator
 packagedb::connectedEnd()
 {
@@ -388,12 +741,13 @@ packagedb::connectedEnd()
 void
 packagedb::markUnVisited()
 {
-  for (packagedb::packagecollection::iterator n = packages.begin ();
-       n != packages.end (); ++n)
-    {
-      packagemeta & pkgm = *(n->second);
-      pkgm.visited(false);
-    }
+  if (++visitGeneration)
+    return;
+  /* Wrapped around; the stamps of long ago would look current. */
+  for (PackageCollection::id_type n = 0; n < packages.ids (); ++n)
+    if (packages[n])
+      packages[n]->visited (false);
+  visitGeneration = 1;
 }
 
 void
@@ -508,25 +862,15 @@ packagedb::guessUserPicked()
       if (!pkgm.installed)
 	continue;
 
-      /* walk through each and clause */
-      vector <vector <PackageSpecification *> *>::const_iterator dp = pkgm.installed.depends()->begin();
-      while (dp != pkgm.installed.depends()->end())
+      /* walk through each and clause, checking each or clause for an
+	 installed match */
+      DependencyGraph::index_type node = pkgm.installed.dependencyNode ();
+      for (DependencyGraph::index_type dp = graph.clauseBegin (node);
+	   dp != graph.clauseEnd (node); ++dp)
 	{
-	  /* check each or clause for an installed match */
-	  vector <PackageSpecification *>::const_iterator i = find_if ((*dp)->begin(), (*dp)->end(), checkForInstalled);
-	  if (i != (*dp)->end())
-	    {
-	      const packagedb::packagecollection::iterator n = packages.find((*i)->packageName());
-	      if (n != packages.end())
-		{
-		  packagemeta *pkgm2 = n->second;
-		  pkgm2->user_picked = FALSE;
-		}
-	      /* skip to next and clause */
-	      ++dp;
-	      continue;
-	    }
-	  ++dp;
+	  PackageCollection::id_type installed = installedAlternative (dp);
+	  if (installed != PackageCollection::npos)
+	    packages[installed]->user_picked = FALSE;
 	}
     }
 }
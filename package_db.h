@@ -18,8 +18,14 @@
 
 /* required to parse this file */
 #include <vector>
+#include <list>
 #include <map>
 #include "String++.h"
+#include "Arena.h"
+#include "PackageCollection.h"
+#include "DependencyGraph.h"
+#include "ProviderIndex.h"
+#include "DependentIndex.h"
 class packagemeta;
 class io_stream;
 class PackageSpecification;
@@ -63,18 +69,34 @@ class packagedb
 {
 public:
   packagedb ();
-  /* 0 on success */
+  /* Write installed.db afresh.  0 on success */
   int flush ();
+  /* Record in the installed.db journal, on disk, that pkg is now
+     installed as it is, or no longer installed; now and then compact the
+     journal into installed.db instead.  0 on success */
+  int journal (packagemeta &pkg);
   void upgrade ();
   packagemeta * findBinary (PackageSpecification const &) const;
   packagemeta * findSource (PackageSpecification const &) const;
+  /* The installed packages, each after those it depends on, except within
+     a dependency loop. */
   PackageDBConnectedIterator connectedBegin();
   PackageDBConnectedIterator connectedEnd();
+  /* The dependency level of the package at i, from connectedBegin (): 0 if
+     it depends on no other installed package, otherwise one more than the
+     highest level of those it depends on (a dependency loop shares one
+     level).  Packages of the same level don't depend on each other. */
+  unsigned int connectedLevel (PackageDBConnectedIterator i);
   void fillMissingCategory();
   void defaultTrust (trusts trust);
+  /* Start a new pass over the packages: none is visited after this. */
   void markUnVisited();
   void setExistence();
-  typedef std::map <std::string, packagemeta *> packagecollection;
+  /* Forget all packages, the installed ones too, so the database can be
+     built from scratch again.  installed.db is only read again by the
+     next packagedb () if reread is set. */
+  static void clear (bool reread = false);
+  typedef PackageCollection packagecollection;
   /* all seen binary packages */
   static packagecollection packages;
   /* all seen source packages */
@@ -82,12 +104,50 @@ public:
   /* all seen categories */
   typedef std::map <std::string, std::vector <packagemeta *>, casecompare_lt_op > categoriesType;
   static categoriesType categories;
+  /* the dependency lists of all package versions, which are freed
+     together with it */
+  static Arena dependencies;
+  /* the sdesc and ldesc texts of all package versions, and in lazy mode
+     the snapshots they refer into instead (see DescriptionText.h), which
+     are freed together with it */
+  static Arena descriptions;
+  static std::list<std::vector<unsigned char> > descriptionSources;
+  /* the depends lists of the package versions, linked to the packages */
+  static DependencyGraph graph;
+  /* the package versions providing each virtual name */
+  static ProviderIndex providers;
+  /* the package versions depending on each package */
+  static DependentIndex dependents;
   static PackageDBActions task;
+  /* installed.db, as it is read: the package file and flags of each
+     installed package, by name */
+  struct installedEntry
+  {
+    std::string inst;
+    int flags;
+  };
+  typedef std::map <std::string, installedEntry> installedEntries;
+  /* packagemeta::visited () is true of the packages visited since this
+     last changed */
+  static unsigned int visitGeneration;
+  /* changes whenever a package gains or loses versions, so that what was
+     worked out from them can tell it is out of date */
+  static unsigned int versionsGeneration;
 private:
   static int installeddbread;	/* do we have to reread this */
   static int installeddbver;
+  /* the journal, once it is open for writing, and how many records it
+     and installed.db hold */
+  static io_stream *journalFile;
+  static unsigned int journalled;
+  /* whether the journal ends in a torn record */
+  static bool journalTorn;
+  static size_t snapshotSize;
   friend class ConnectedLoopFinder;
   static std::vector <packagemeta *> dependencyOrderedPackages;
+  /* the connectedLevel () of each of dependencyOrderedPackages */
+  static std::vector <unsigned int> dependencyLevels;
+  void link ();
   void guessUserPicked(void);
 };
 
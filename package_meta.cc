@@ -91,14 +91,14 @@ packagemeta::_actions::caption ()
 }
 
 packagemeta::packagemeta (packagemeta const &rhs) :
-  name (rhs.name), key (rhs.name),
+  name (rhs.name), key (name),
   categories (rhs.categories), versions (rhs.versions),
   installed (rhs.installed), prev (rhs.prev),
   curr (rhs.curr),
   exp (rhs.exp),
   desired (rhs.desired),
   architecture (rhs.architecture), priority (rhs.priority),
-  visited_(rhs.visited_)
+  visited_(rhs.visited_), versionIndex (rhs.versionIndex)
 {
   
 }
@@ -116,8 +116,15 @@ template<class T> struct removeCategory : public unary_function<T, void>
   removeCategory(packagemeta *pkg) : _pkg (pkg) {}
   void operator() (T x) 
     {
-      vector <packagemeta *> &aList = packagedb::categories[x]; 
-      aList.erase (find (aList.begin(), aList.end(), _pkg));
+      packagedb::categoriesType::iterator c =
+	packagedb::categories.find (x.str ());
+      if (c == packagedb::categories.end ())
+	return;
+      vector <packagemeta *>::iterator i =
+	find (c->second.begin (), c->second.end (), _pkg);
+      /* source packages have categories but aren't listed in them */
+      if (i != c->second.end ())
+	c->second.erase (i);
     }
   packagemeta *_pkg;
 };
@@ -125,16 +132,36 @@ template<class T> struct removeCategory : public unary_function<T, void>
 
 packagemeta::~packagemeta()
 {
-  for_each (categories.begin (), categories.end (), removeCategory<std::string> (this));
+  for_each (categories.begin (), categories.end (), removeCategory<pooled_string> (this));
   categories.clear ();
-  versions.clear ();
+  clearVersions ();
 }
 
 void
 packagemeta::add_version (packageversion & thepkg)
 {
   /* todo: check return value */
-  versions.insert (thepkg);
+  if (versions.insert (thepkg).second)
+    {
+      versionIndex.insert (make_pair (thepkg.Canonical_version (), thepkg));
+      ++packagedb::versionsGeneration;
+    }
+}
+
+packageversion
+packagemeta::findVersion (const std::string& canonical) const
+{
+  std::unordered_map<std::string, packageversion>::const_iterator i =
+    versionIndex.find (canonical);
+  return i == versionIndex.end () ? packageversion () : i->second;
+}
+
+void
+packagemeta::clearVersions ()
+{
+  versions.clear ();
+  versionIndex.clear ();
+  ++packagedb::versionsGeneration;
 }
 
 /* assumption: package thepkg is already in the metadata list. */
@@ -217,12 +244,13 @@ packagemeta::uninstall ()
 
 
 void
-packagemeta::add_category (const std::string& cat)
+packagemeta::add_category (const std::string& aCat)
 {
+  pooled_string cat (aCat);
   if (categories.find (cat) != categories.end())
     return;
   /* add a new record for the package list */
-  packagedb::categories[cat].push_back (this);
+  packagedb::categories[cat.str ()].push_back (this);
   categories.insert (cat);
 }
 
@@ -310,7 +338,7 @@ bool packagemeta::isManuallyWanted() const
      of the categories it is in? */
   if (!bReturn && parsed_categories.size ())
     {
-      std::set<std::string, casecompare_lt_op>::iterator curcat;
+      std::set<pooled_string, casecompare_lt_op>::iterator curcat;
       for (curcat = categories.begin (); curcat != categories.end (); curcat++)
 	if (parsed_categories.find (*curcat) != parsed_categories.end ())
 	  {
@@ -360,7 +388,7 @@ bool packagemeta::isManuallyDeleted() const
      of the categories it is in? */
   if (!bReturn && parsed_delete_categories.size ())
     {
-      std::set<std::string, casecompare_lt_op>::iterator curcat;
+      std::set<pooled_string, casecompare_lt_op>::iterator curcat;
       for (curcat = categories.begin (); curcat != categories.end (); curcat++)
 	if (parsed_delete_categories.find (*curcat) != parsed_delete_categories.end ())
 	  {
@@ -463,22 +491,30 @@ packagemeta::set_action (trusts const trust)
 }
 
 int
-packagemeta::set_requirements (trusts deftrust, size_t depth)
+packagemeta::set_requirements (trusts deftrust, size_t &touched)
 {
   if (visited())
     return 0;
-  /* Only prevent further checks once we have been required by something else */
-  if (depth)
-    visited(true);
+  /* Only packages required by something else are marked visited, so this
+     one may be checked again when something turns out to need it. */
   int changed = 0;
+  std::vector<packagemeta *> pending;
   /* handle build-depends */
-  if (depth == 0 && desired.sourcePackage ().picked())
-    changed += desired.sourcePackage ().set_requirements (deftrust, depth + 1);
-  if (!desired || (desired != installed && !desired.picked ()))
-    /* uninstall || source only */
-    return changed;
-
-  return changed + desired.set_requirements (deftrust, depth);
+  if (desired.sourcePackage ().picked())
+    changed += desired.sourcePackage ().set_requirements (deftrust, pending);
+  packagemeta *pkg = this;
+  for (;;)
+    {
+      ++touched;
+      if (pkg->desired && (pkg->desired == pkg->installed
+			   || pkg->desired.picked ()))
+	/* not uninstall or source only */
+	changed += pkg->desired.set_requirements (deftrust, pending);
+      if (pending.empty ())
+	return changed;
+      pkg = pending.back ();
+      pending.pop_back ();
+    }
 }
 
 
@@ -619,13 +655,13 @@ packagemeta::trustLabel(packageversion const &aVersion) const
 void
 packagemeta::visited(bool const &aBool)
 {
-  visited_ = aBool;
+  visited_ = aBool ? packagedb::visitGeneration : 0;
 }
 
 bool
 packagemeta::visited() const
 {
-  return visited_;
+  return visited_ == packagedb::visitGeneration;
 }
 
 void
@@ -694,7 +730,9 @@ packagemeta::ScanDownloadedFiles (bool mirror_mode)
 		pkg.curr = packageversion ();
 	      if (pkg.exp == *i)
 		pkg.exp = packageversion ();
+	      pkg.versionIndex.erase (i->Canonical_version ());
 	      pkg.versions.erase (i++);
+	      ++packagedb::versionsGeneration;
 	      /* For now, leave the source version alone */
 	    }
 	  else
@@ -22,9 +22,11 @@ class category;
 
 /* Required to parse this completely */
 #include <set>
+#include <unordered_map>
 #include "PackageTrust.h"
 #include "package_version.h"
 #include "package_message.h"
+#include "StringPool.h"
 
 typedef std::pair<const std::string, std::vector<packagemeta *> > Category;
 
@@ -35,14 +37,18 @@ public:
   static void ScanDownloadedFiles (bool);
   packagemeta (packagemeta const &);
   packagemeta (const std::string& pkgname)
-  : name (pkgname), key(pkgname), user_picked (false),
-    architecture (), priority(), visited_(false)
+  : name (StringPool::intern (pkgname)), key (name), user_picked (false),
+    architecture (), priority(), visited_(0)
   {
   }
 
   ~packagemeta ();
 
   void add_version (packageversion &);
+  /* The version whose canonical version string is exactly canonical, or an
+     empty packageversion. */
+  packageversion findVersion (const std::string& canonical) const;
+  void clearVersions ();
   void set_installed (packageversion &);
   void visited(bool const &);
   bool visited() const;
@@ -74,10 +80,13 @@ public:
   void set_action (trusts const t);
   void set_action (_actions, packageversion const & default_version);
   void uninstall ();
-  int set_requirements (trusts deftrust, size_t depth);
+  /* Select what the desired version needs, what that needs in turn, and
+     so on.  touched is increased by the number of packages whose
+     requirements were looked at. */
+  int set_requirements (trusts deftrust, size_t &touched);
   // explicit separation for generic programming.
   int set_requirements (trusts deftrust) 
-    { return set_requirements (deftrust, 0); }
+    { size_t touched = 0; return set_requirements (deftrust, touched); }
   void set_message (const std::string& message_id, const std::string& message_string)
   {
     message.set (message_id, message_string);
@@ -110,8 +119,10 @@ public:
     return installed;
   }
 
-  std::string name;			/* package name, like "cygwin" */
-  std::string key;
+  /* Both interned, so that the thousands of packages and the dependencies
+     naming them share one copy of each name. */
+  const std::string &name;		/* package name, like "cygwin" */
+  const std::string &key;
 
   /* true if package was selected on command-line. */
   bool isManuallyWanted() const;
@@ -124,8 +135,10 @@ public:
    * of a package disagree.... the first one read in will take precedence.
    */
   void add_category (const std::string& );
-  std::set <std::string, casecompare_lt_op> categories;
+  std::set <pooled_string, casecompare_lt_op> categories;
   const std::string getReadableCategoryList () const;
+  /* Only add to or clear this by the functions above, which keep
+     versionIndex in step. */
   std::set <packageversion> versions;
 
   /* Did the user already pick a version at least once? */
@@ -166,7 +179,11 @@ protected:
   packagemeta &operator= (packagemeta const &);
 private:
   std::string trustLabel(packageversion const &) const;
-  bool visited_;
+  /* the packagedb::visitGeneration it was last visited in */
+  unsigned int visited_;
+  /* versions by canonical version string, so that merging the same
+     version from several mirrors doesn't have to search versions */
+  std::unordered_map<std::string, packageversion> versionIndex;
 };
 
 #endif /* SETUP_PACKAGE_META_H */
@@ -29,6 +29,16 @@ static const char *cvsid =
 site::site (const std::string& newkey) : key(newkey)
 {
 };
+
+void
+packagesource::add_site (const std::string& key)
+{
+  /* there are only ever a few mirrors */
+  for (sitestype::iterator i = sites.begin (); i != sites.end (); ++i)
+    if (!casecompare (i->key, key))
+      return;
+  sites.push_back (site (key));
+}
   
 void
 packagesource::set_canonical (char const *fn)
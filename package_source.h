@@ -112,6 +112,8 @@ public:
   MD5Sum md5;
   typedef std::vector <site> sitestype;
   sitestype sites;
+  /* Add the mirror key to sites unless it's there already. */
+  void add_site (const std::string& key);
 
   virtual ~ packagesource ()
   {
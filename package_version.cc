@@ -31,6 +31,7 @@ static const char *cvsid =
 #include "download.h"
 #include "Exception.h"
 #include "csu_util/version_compare.h"
+#include <unordered_map>
 
 using namespace std;
 
@@ -205,6 +206,12 @@ packageversion::set_sdesc (const std::string& sdesc)
   data->set_sdesc (sdesc);
 }
 
+void
+packageversion::set_sdesc (DescriptionText const &sdesc)
+{
+  data->set_sdesc (sdesc);
+}
+
 const std::string
 packageversion::LDesc () const
 {
@@ -217,6 +224,12 @@ packageversion::set_ldesc (const std::string& ldesc)
   data->set_ldesc (ldesc);
 }
 
+void
+packageversion::set_ldesc (DescriptionText const &ldesc)
+{
+  data->set_ldesc (ldesc);
+}
+
 packageversion
 packageversion::sourcePackage() const
 {
@@ -235,55 +248,67 @@ packageversion::setSourcePackageSpecification (PackageSpecification const &spec)
   data->setSourcePackageSpecification(spec);
 }
 
-vector <vector <PackageSpecification *> *> *
+PackageAndList *
 packageversion::depends()
 {
   return &data->depends;
 }
 
-const vector <vector <PackageSpecification *> *> *
+const PackageAndList *
 packageversion::depends() const
 {
   return &data->depends;
 }
 
-vector <vector <PackageSpecification *> *> *
+DependencyGraph::index_type
+packageversion::dependencyNode ()
+{
+  if (data->dependencyNode == DependencyGraph::none
+      || data->dependencyGeneration != packagedb::graph.generation ())
+    {
+      data->dependencyNode = packagedb::graph.add (data->depends);
+      data->dependencyGeneration = packagedb::graph.generation ();
+    }
+  return data->dependencyNode;
+}
+
+PackageAndList *
 packageversion::predepends()
 {
       return &data->predepends;
 }
 
-vector <vector <PackageSpecification *> *> *
+PackageAndList *
 packageversion::recommends()
 {
       return &data->recommends;
 }
 
-vector <vector <PackageSpecification *> *> *
+PackageAndList *
 packageversion::suggests()
 {
       return &data->suggests;
 }
 
-vector <vector <PackageSpecification *> *> *
+PackageAndList *
 packageversion::replaces()
 {
       return &data->replaces;
 }
 
-vector <vector <PackageSpecification *> *> *
+PackageAndList *
 packageversion::conflicts()
 {
       return &data->conflicts;
 }
 
-vector <vector <PackageSpecification *> *> *
+PackageAndList *
 packageversion::provides()
 {
       return &data->provides;
 }
 
-vector <vector <PackageSpecification *> *> *
+PackageAndList *
 packageversion::binaries()
 {
       return &data->binaries;
@@ -357,14 +382,102 @@ packageversion::scan (bool mirror_mode)
     }
 }
 
+/* What the checks below need to know of the versions of the package an
+   alternative names: whether the installed one meets the alternative, and
+   whether any does.  Many packages ask the same of one package, so the
+   answers are kept for each distinct question - the package, the operator
+   and the version - for the rest of the pass (packagedb::visitGeneration),
+   while the versions of the packages don't change. */
+class VersionChecks
+{
+public:
+  enum
+  {
+    installedMeets = 1,
+    anyMeets = 2
+  };
+  VersionChecks () : pass (0), generation (0), cached (0), checked (0) {}
+  int find (DependencyGraph::index_type alternative);
+  /* the questions of this pass answered from before, and all of them */
+  size_t cachedThisPass () const { return current () ? cached : 0; }
+  size_t checkedThisPass () const { return current () ? checked : 0; }
+private:
+  struct Question
+  {
+    PackageCollection::id_type id;
+    PackageSpecification::_operators const *op;
+    const std::string *versionKey;
+    bool operator == (Question const &rhs) const
+    {
+      return id == rhs.id && op == rhs.op && versionKey == rhs.versionKey;
+    }
+  };
+  struct QuestionHash
+  {
+    size_t operator () (Question const &q) const
+    {
+      /* interned, so the pointers stand for the strings */
+      return q.id * 1000003u ^ std::hash<const void *> () (q.op) * 31
+	^ std::hash<const void *> () (q.versionKey);
+    }
+  };
+  bool current () const
+  {
+    return pass == packagedb::visitGeneration
+      && generation == packagedb::versionsGeneration;
+  }
+  std::unordered_map<Question, int, QuestionHash> answers;
+  unsigned int pass;
+  unsigned int generation;
+  size_t cached;
+  size_t checked;
+};
+
+int
+VersionChecks::find (DependencyGraph::index_type alternative)
+{
+  if (!current ())
+    {
+      answers.clear ();
+      pass = packagedb::visitGeneration;
+      generation = packagedb::versionsGeneration;
+      cached = checked = 0;
+    }
+  ++checked;
+  PackageSpecification *spec = packagedb::graph.spec (alternative);
+  Question q = { packagedb::graph.target (alternative),
+		 spec->versionOperator (), &spec->versionKey () };
+  std::pair<std::unordered_map<Question, int, QuestionHash>::iterator, bool>
+    answer = answers.insert (std::make_pair (q, 0));
+  if (!answer.second)
+    {
+      ++cached;
+      return answer.first->second;
+    }
+  packagemeta *required = packagedb::packages[q.id];
+  if (required->installed && spec->satisfiesVersion (required->installed))
+    answer.first->second |= installedMeets;
+  if (spec->satisfyingVersions (required->versions))
+    answer.first->second |= anyMeets;
+  return answer.first->second;
+}
+
+static VersionChecks versionChecks;
+
+void
+packageversion::versionChecksThisPass (size_t &cached, size_t &checked)
+{
+  cached = versionChecks.cachedThisPass ();
+  checked = versionChecks.checkedThisPass ();
+}
+
 static bool
-checkForInstalled (PackageSpecification *spec)
+checkForInstalled (DependencyGraph::index_type alternative)
 {
-  packagedb db;
-  packagemeta *required = db.findBinary (*spec);
+  packagemeta *required = packagedb::graph.package (alternative);
   if (!required)
     return false;
-  if (spec->satisfies (required->installed)
+  if ((versionChecks.find (alternative) & VersionChecks::installedMeets)
       && required->desired == required->installed )
     /* done, found a satisfactory installed version that will remain
        installed */
@@ -373,37 +486,99 @@ checkForInstalled (PackageSpecification *spec)
 }
 
 static bool
-checkForUpgradeable (PackageSpecification *spec)
+checkForUpgradeable (DependencyGraph::index_type alternative)
 {
-  packagedb db;
-  packagemeta *required = db.findBinary (*spec);
+  packagemeta *required = packagedb::graph.package (alternative);
   if (!required || !required->installed)
     return false;
-  for (set <packageversion>::iterator i = required->versions.begin();
-       i != required->versions.end(); ++i)
-    if (spec->satisfies (*i))
-      return true;
-  return false;
+  return versionChecks.find (alternative) & VersionChecks::anyMeets;
 }
 
 static bool
-checkForSatisfiable (PackageSpecification *spec)
+checkForSatisfiable (DependencyGraph::index_type alternative)
 {
-  packagedb db;
-  packagemeta *required = db.findBinary (*spec);
+  packagemeta *required = packagedb::graph.package (alternative);
   if (!required)
     return false;
-  for (set <packageversion>::iterator i = required->versions.begin();
-       i != required->versions.end(); ++i)
-    if (spec->satisfies (*i))
-      return true;
-  return false;
+  return versionChecks.find (alternative) & VersionChecks::anyMeets;
+}
+
+/* The first alternative of clause that passes check, or the end of the
+   clause. */
+static DependencyGraph::index_type
+findAlternative (DependencyGraph::index_type clause,
+		 bool (*check) (DependencyGraph::index_type))
+{
+  DependencyGraph::index_type i = packagedb::graph.alternativeBegin (clause);
+  while (i != packagedb::graph.alternativeEnd (clause) && !check (i))
+    ++i;
+  return i;
 }
 
-static int
-select (trusts deftrust, size_t depth, packagemeta *required,
+static bool
+providerInstalled (packagemeta *pkg, ProviderIndex::Provider const &p)
+{
+  return p.version == pkg->installed && pkg->desired == pkg->installed;
+}
+
+static bool
+providerUpgradeable (packagemeta *pkg, ProviderIndex::Provider const &)
+{
+  return pkg->installed;
+}
+
+static bool
+providerSatisfiable (packagemeta *, ProviderIndex::Provider const &)
+{
+  return true;
+}
+
+/* When no alternative of clause passes a check, the first version
+   providing one of them whose package passes check, and that alternative;
+   NULL if there is none. */
+static ProviderIndex::Provider const *
+findProvider (DependencyGraph::index_type clause,
+	      bool (*check) (packagemeta *, ProviderIndex::Provider const &),
+	      DependencyGraph::index_type &alternative)
+{
+  DependencyGraph &graph = packagedb::graph;
+  if (packagedb::providers.empty ())
+    return NULL;
+  for (DependencyGraph::index_type i = graph.alternativeBegin (clause);
+       i != graph.alternativeEnd (clause); ++i)
+    {
+      ProviderIndex::range r = packagedb::providers.find (*graph.spec (i));
+      for (ProviderIndex::const_iterator p = r.first; p != r.second; ++p)
+	{
+	  packagemeta *pkg = packagedb::packages[p->id];
+	  if (pkg && check (pkg, *p) && graph.spec (i)->satisfiedBy (*p->provided))
+	    {
+	      alternative = i;
+	      return &*p;
+	    }
+	}
+    }
+  return NULL;
+}
+
+/* where select () adds the packages whose selection it changes, if it
+   does */
+static std::vector<packagemeta *> *selectionChanges;
+
+void
+packageversion::recordSelectionChanges (std::vector<packagemeta *> *changes)
+{
+  selectionChanges = changes;
+}
+
+static void
+select (std::vector<packagemeta *> &pending, packagemeta *required,
         const packageversion &aVersion)
 {
+  if (selectionChanges
+      && (required->desired != aVersion || required->desired.picked ()
+	  != (required->installed != aVersion)))
+    selectionChanges->push_back (required);
   /* preserve source */
   bool sourceticked = required->desired.sourcePackage ().picked();
   /* install this version */
@@ -411,50 +586,67 @@ select (trusts deftrust, size_t depth, packagemeta *required,
   required->desired.pick (required->installed != required->desired, required);
   required->desired.sourcePackage ().pick (sourceticked, NULL);
   /* does this requirement have requirements? */
-  return required->set_requirements (deftrust, depth + 1);
+  if (!required->visited ())
+    {
+      required->visited (true);
+      pending.push_back (required);
+    }
 }
 
-static int
-processOneDependency (trusts deftrust, size_t depth,
-                      PackageSpecification *spec)
+static void
+processOneDependency (trusts deftrust, std::vector<packagemeta *> &pending,
+                      DependencyGraph::index_type alternative)
 {
   /* TODO: add this to a set of packages to be offered to meet the
      requirement. For now, simply set the install to the first
      satisfactory version. The user can step through the list if
      desired */
-  packagedb db;
-  packagemeta *required = db.findBinary (*spec);
+  packagemeta *required = packagedb::graph.package (alternative);
+  PackageSpecification *spec = packagedb::graph.spec (alternative);
 
   packageversion trusted = required->trustp(false, deftrust);
   if (spec->satisfies (trusted)) {
-      return select (deftrust, depth, required, trusted);
+      select (pending, required, trusted);
+      return;
   }
 
   Log (LOG_TIMESTAMP) << "Warning, the default trust level for package "
     << trusted.Name() << " does not meet this specification " << *spec
     << endLog;
   
-  set <packageversion>::iterator v;
-  for (v = required->versions.begin();
-    v != required->versions.end() && !spec->satisfies (*v); ++v);
-
-  if (v == required->versions.end())
+  std::vector <packageversion> satisfying;
+  if (!spec->satisfyingVersions (required->versions, &satisfying))
       /* assert ?! */
-      return 0;
+      return;
   
-  return select (deftrust, depth, required, *v);
+  select (pending, required, satisfying.front ());
+}
+
+/* Like processOneDependency (), for a version providing what alternative
+   names: the trusted version of its package if that provides it too. */
+static void
+processOneProvider (trusts deftrust, std::vector<packagemeta *> &pending,
+		    DependencyGraph::index_type alternative,
+		    ProviderIndex::Provider const *provider)
+{
+  packagemeta *required = packagedb::packages[provider->id];
+  packageversion trusted = required->trustp (false, deftrust);
+  if (packagedb::graph.spec (alternative)->satisfies (trusted))
+    select (pending, required, trusted);
+  else
+    select (pending, required, provider->version);
 }
 
 int
-packageversion::set_requirements (trusts deftrust, size_t depth)
+packageversion::set_requirements (trusts deftrust,
+				  std::vector<packagemeta *> &pending)
 {
   int changed = 0;
-  vector <vector <PackageSpecification *> *>::iterator dp = depends ()->begin();
-  /* cheap test for too much recursion */
-  if (depth > 30)
-    return changed;
+  DependencyGraph &graph = packagedb::graph;
+  DependencyGraph::index_type node = dependencyNode ();
   /* walk through each and clause */
-  while (dp != depends ()->end())
+  for (DependencyGraph::index_type dp = graph.clauseBegin (node);
+       dp != graph.clauseEnd (node); ++dp)
     {
       /* three step:
 	 1) is a satisfactory or clause installed?
@@ -462,37 +654,46 @@ packageversion::set_requirements (trusts deftrust, size_t depth)
 	 a satisfactory version available installed?
 	 3) is a satisfactory package available?
 	 */
+      /* At each step the packages named come first, then the versions
+	 providing the names. */
+      DependencyGraph::index_type end = graph.alternativeEnd (dp);
+      ProviderIndex::Provider const *provider;
       /* check each or clause for an installed match */
-      vector <PackageSpecification *>::iterator i =
-	find_if ((*dp)->begin(), (*dp)->end(), checkForInstalled);
-      if (i != (*dp)->end())
-	{
-	  /* we found an installed ok package */
-	  /* next and clause */
-	  ++dp;
-	  continue;
-	}
+      DependencyGraph::index_type i = findAlternative (dp, checkForInstalled);
+      if (i != end || findProvider (dp, providerInstalled, i))
+	/* we found an installed ok package */
+	continue;
       /* check each or clause for an upgradeable version */
-      i = find_if ((*dp)->begin(), (*dp)->end(), checkForUpgradeable);
-      if (i != (*dp)->end())
+      i = findAlternative (dp, checkForUpgradeable);
+      if (i != end)
 	{
 	  /* we found a package that can be up/downgraded to meet the
-	     requirement. (*i is the packagespec that can be satisfied.)
+	     requirement. (i is the alternative that can be satisfied.)
 	     */
-	  ++dp;
-	  changed += processOneDependency (deftrust, depth, *i) + 1;
+	  processOneDependency (deftrust, pending, i);
+	  ++changed;
 	  continue;
 	}
-      /* check each or clause for an installable version */
-      i = find_if ((*dp)->begin(), (*dp)->end(), checkForSatisfiable);
-      if (i != (*dp)->end())
+      if ((provider = findProvider (dp, providerUpgradeable, i)))
 	{
-	  /* we found a package that can be installed to meet the requirement */
-	  ++dp;
-	  changed += processOneDependency (deftrust, depth, *i) + 1;
+	  processOneProvider (deftrust, pending, i, provider);
+	  ++changed;
 	  continue;
 	}
-      ++dp;
+      /* check each or clause for an installable version */
+      i = findAlternative (dp, checkForSatisfiable);
+      if (i != end)
+	{
+	  /* we found a package that can be installed to meet the
+	     requirement */
+	  processOneDependency (deftrust, pending, i);
+	  ++changed;
+	}
+      else if ((provider = findProvider (dp, providerSatisfiable, i)))
+	{
+	  processOneProvider (deftrust, pending, i, provider);
+	  ++changed;
+	}
     }
   return changed;
 }
@@ -512,30 +713,41 @@ packageversion::scripts()
 int
 packageversion::compareVersions(const packageversion &a, const packageversion &b)
 {
-  /* Compare Vendor_version */
-  int comparison = version_compare(a.Vendor_version(), b.Vendor_version());
- 
+  /* Compare Vendor_version, and if they are tied, Package_version: the
+     keys hold both, made when the version was set */
+  int comparison = a.data->versionKey.compare (b.data->versionKey);
+
 #if DEBUG
-  Log (LOG_BABBLE) << "vendor version comparison " << a.Vendor_version() << " and " << b.Vendor_version() << ", result was " << comparison << endLog;
+  Log (LOG_BABBLE) << "version comparison " << a.Canonical_version() << " and " << b.Canonical_version() << ", result was " << comparison << endLog;
 #endif
 
-  if (comparison != 0)
-    {
-      return comparison;
-    }
+  return comparison < 0 ? -1 : comparison > 0;
+}
 
-  /* Vendor_version are tied, compare Package_version */
-#if DEBUG
-  Log (LOG_BABBLE) <<  "package version comparison " << a.Package_version() << " and " << b.Package_version() << ", result was " << comparison << endLog;
-#endif
+const std::string &
+packageversion::versionKey () const
+{
+  return data->versionKey;
+}
 
-  comparison = version_compare(a.Package_version(), b.Package_version());
-  return comparison;
+std::string
+packageversion::canonicalVersionKey (const std::string& canonical)
+{
+  /* the package version is what follows the last '-', as in
+     cygpackage::setCanonicalVersion () */
+  std::string::size_type dash = canonical.rfind ('-');
+  if (dash == std::string::npos)
+    return version_key (canonical) + version_key ("0");
+  return version_key (canonical.substr (0, dash))
+    + version_key (canonical.substr (dash + 1));
 }
 
 /* the parent data class */
   
-_packageversion::_packageversion ():picked (false), references (0)
+_packageversion::_packageversion ():
+  dependencyNode (DependencyGraph::none), dependencyGeneration (0),
+  versionKey (version_key (std::string ()) + version_key (std::string ())),
+  picked (false), references (0)
 {
 }
 
@@ -613,18 +825,18 @@ _packageversion::scripts()
 }
 
 void
-dumpAndList (vector<vector <PackageSpecification *> *> const *currentAndList,
+dumpAndList (PackageAndList const *currentAndList,
              std::ostream &logger)
 {
   return;
   if (currentAndList)
   {
-    vector<vector <PackageSpecification *> *>::const_iterator iAnd =
+    PackageAndList::const_iterator iAnd =
       currentAndList->begin();
     while (true)
     {
       if ((*iAnd)->size() > 1) Log (LOG_BABBLE) << "( ";
-      vector<PackageSpecification *>::const_iterator i= (*iAnd)->begin();
+      PackageOrList::const_iterator i= (*iAnd)->begin();
       while (true)
       {
         Log (LOG_BABBLE) << **i;
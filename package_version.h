@@ -42,7 +42,9 @@ class CategoryList;
 /*Required for parsing */
 #include "package_source.h"
 #include "PackageSpecification.h"
+#include "DependencyGraph.h"
 #include "PackageTrust.h"
+#include "DescriptionText.h"
 #include "script.h"
 #include <vector>
 
@@ -111,16 +113,20 @@ public:
   const std::string getnextfile ();
   const std::string SDesc () const;
   void set_sdesc (const std::string& );
+  void set_sdesc (DescriptionText const &);
   const std::string LDesc () const;
   void set_ldesc (const std::string& );
+  void set_ldesc (DescriptionText const &);
   packageversion sourcePackage () const;
   PackageSpecification & sourcePackageSpecification ();
   void setSourcePackageSpecification (PackageSpecification const &);
 
   /* invariant: these never return NULL */
-  std::vector <std::vector <PackageSpecification *> *> *depends(), *predepends(), 
+  PackageAndList *depends(), *predepends(), 
   *recommends(), *suggests(), *replaces(), *conflicts(), *provides(), *binaries();
-  const std::vector <std::vector <PackageSpecification *> *> *depends() const; 
+  const PackageAndList *depends() const; 
+  /* depends () in packagedb::graph, added there if need be */
+  DependencyGraph::index_type dependencyNode ();
 
   bool picked() const;   /* true if this version is to be installed */
   void pick(bool, packagemeta *); /* trigger an install/reinsall */
@@ -139,14 +145,27 @@ public:
   /* scan for local copies */
   void scan (bool);
 
-  /* ensure that the depends clause is satisfied */
-  int set_requirements (trusts deftrust, size_t depth = 0);
+  /* ensure that the depends clause is satisfied; the packages selected
+     for it that haven't been visited yet are marked visited and added to
+     pending, whose requirements are left to the caller */
+  int set_requirements (trusts deftrust, std::vector<packagemeta *> &pending);
+  /* Of the times set_requirements () asked this pass whether versions of a
+     package meet a requirement, checked, how many were answered from
+     before, cached. */
+  static void versionChecksThisPass (size_t &cached, size_t &checked);
+  /* Have set_requirements () add the packages whose selection it changes
+     to changes, until this is called again; NULL to stop. */
+  static void recordSelectionChanges (std::vector<packagemeta *> *changes);
 
   void addScript(Script const &);
   std::vector <Script> &scripts();
 
   /* utility function to compare package versions */
   static int compareVersions(const packageversion &a, const packageversion &b);
+  /* what compareVersions () compares: see _packageversion::versionKey */
+  const std::string &versionKey () const;
+  /* the versionKey () of a version whose Canonical_version () is canonical */
+  static std::string canonicalVersionKey (const std::string& canonical);
 
 private:
   _packageversion *data; /* Invariant: * data is always valid */
@@ -176,8 +195,13 @@ public:
   virtual const std::string getnextfile () = 0;
   virtual const std::string SDesc () = 0;
   virtual void set_sdesc (const std::string& ) = 0;
+  /* a description that needn't be copied; see DescriptionText.h */
+  virtual void set_sdesc (DescriptionText const &desc)
+    { set_sdesc (desc.str ()); }
   virtual const std::string LDesc () = 0;
   virtual void set_ldesc (const std::string& ) = 0;
+  virtual void set_ldesc (DescriptionText const &desc)
+    { set_ldesc (desc.str ()); }
   /* only semantically meaningful for binary packages */
   /* direct link to the source package for this binary */
   /* if multiple versions exist and the source doesn't discriminate
@@ -187,8 +211,15 @@ public:
   virtual PackageSpecification & sourcePackageSpecification ();
   virtual void setSourcePackageSpecification (PackageSpecification const &);
   
-  std::vector <std::vector <PackageSpecification *> *> depends, predepends, recommends,
+  PackageAndList depends, predepends, recommends,
   suggests, replaces, conflicts, provides, binaries;
+  /* depends in packagedb::graph, if it was added to this generation of
+     the graph */
+  DependencyGraph::index_type dependencyNode;
+  unsigned int dependencyGeneration;
+  /* version_key () of Vendor_version () followed by that of
+     Package_version (), for compareVersions () */
+  std::string versionKey;
   
   virtual void pick(bool const &newValue) { picked = newValue;}
   bool picked;	/* non zero if this version is to be installed */
@@ -213,6 +244,6 @@ protected:
 };
 
 // not sure where this belongs :}.
-void dumpAndList (std::vector<std::vector <PackageSpecification *> *> const *currentAndList, std::ostream &);
+void dumpAndList (PackageAndList const *currentAndList, std::ostream &);
 
 #endif /* SETUP_PACKAGE_VERSION_H */
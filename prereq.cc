@@ -166,6 +166,28 @@ map <packagemeta *, vector <packagemeta *>, packagemeta_ltcomp> PrereqChecker::u
 map <std::string, vector <packagemeta *> > PrereqChecker::notfound;
 trusts PrereqChecker::theTrust = TRUST_CURR;
 
+/* For a dependency on a name no package has: true if a version to be
+   installed provides it.  Otherwise dep is set to the package of the first
+   version that does, if there is one. */
+static bool
+providedFor (PackageSpecification const &spec, packagemeta *&dep)
+{
+  ProviderIndex::range r = packagedb::providers.find (spec);
+  for (ProviderIndex::const_iterator p = r.first; p != r.second; ++p)
+    {
+      if (!spec.satisfiedBy (*p->provided))
+        continue;
+      packagemeta *pkg = packagedb::packages[p->id];
+      if (!pkg)
+        continue;
+      if (pkg->desired == p->version)
+        return true;
+      if (!dep)
+        dep = pkg;
+    }
+  return false;
+}
+
 /* This function builds a list of unmet dependencies to present to the user on
    the PrereqPage propsheet.
 
@@ -216,10 +238,10 @@ PrereqChecker::isMet ()
 
       // Fetch the dependencies of the package. This assumes that the
       // dependencies of the prev, curr, and exp versions are all the same.
-      vector <vector <PackageSpecification *> *> *deps = pack->curr.depends ();
+      PackageAndList *deps = pack->curr.depends ();
 
       // go through the package's dependencies
-      for (vector <vector <PackageSpecification *> *>::iterator d =
+      for (PackageAndList::iterator d =
             deps->begin (); d != deps->end (); ++d)
         {
           // XXX: the following assumes that there is only a single
@@ -229,6 +251,9 @@ PrereqChecker::isMet ()
           PackageSpecification *dep_spec = (*d)->at(0);
           packagemeta *dep = db.findBinary (*dep_spec);
 
+          if (!dep && providedFor (*dep_spec, dep))
+            continue;
+
           if (dep)
             {
               if (!(dep->desired && dep_spec->satisfies (dep->desired)))
@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#include "query.h"
+
+#include <iostream>
+#include <vector>
+#include "getopt++/StringOption.h"
+#include "ini.h"
+#include "localdir.h"
+#include "LogSingleton.h"
+#include "mount.h"
+#include "package_db.h"
+#include "package_meta.h"
+#include "PackageClosure.h"
+#include "state.h"
+
+extern StringOption RootOption;
+
+typedef PackageCollection::id_type id_type;
+
+/* A package that is installed for its own sake. */
+static bool
+wanted (packagemeta const *pkg)
+{
+  return pkg->user_picked
+    || pkg->categories.find ("Base") != pkg->categories.end ();
+}
+
+/* The installed package meeting the depends clause c: one of the packages
+   named, else one providing a name; npos if none is installed. */
+static id_type
+installedFor (DependencyGraph::index_type c)
+{
+  DependencyGraph &graph = packagedb::graph;
+  for (DependencyGraph::index_type a = graph.alternativeBegin (c);
+       a != graph.alternativeEnd (c); ++a)
+    {
+      packagemeta *pkg = graph.package (a);
+      if (pkg && pkg->installed
+	  && graph.spec (a)->satisfiesVersion (pkg->installed))
+	return graph.target (a);
+    }
+  for (DependencyGraph::index_type a = graph.alternativeBegin (c);
+       a != graph.alternativeEnd (c); ++a)
+    {
+      ProviderIndex::range r = packagedb::providers.find (*graph.spec (a));
+      for (ProviderIndex::const_iterator p = r.first; p != r.second; ++p)
+	if (packagedb::packages[p->id]->installed == p->version
+	    && graph.spec (a)->satisfiedBy (*p->provided))
+	  return p->id;
+    }
+  return PackageCollection::npos;
+}
+
+static void
+rdepends (id_type id)
+{
+  packagedb db;
+  DependentIndex::range r = db.dependents.find (id);
+  for (DependentIndex::const_iterator d = r.first; d != r.second; ++d)
+    if (db.packages[d->id]->installed == d->version)
+      std::cout << db.packages[id]->name << ": "
+		<< db.packages[d->id]->name << std::endl;
+}
+
+/* Breadth first, so the packages needed directly come first. */
+static void
+depends (id_type id)
+{
+  packagedb db;
+  DependencyGraph &graph = db.graph;
+  std::vector<bool> seen (db.packages.ids ());
+  std::vector<id_type> queue (1, id);
+  seen[id] = true;
+  for (size_t next = 0; next < queue.size (); ++next)
+    {
+      DependencyGraph::index_type node
+	= db.packages[queue[next]]->installed.dependencyNode ();
+      for (DependencyGraph::index_type c = graph.clauseBegin (node);
+	   c != graph.clauseEnd (node); ++c)
+	{
+	  id_type needed = installedFor (c);
+	  if (needed != PackageCollection::npos)
+	    {
+	      if (seen[needed])
+		continue;
+	      seen[needed] = true;
+	      queue.push_back (needed);
+	      std::cout << db.packages[id]->name << ": "
+			<< db.packages[needed]->name << std::endl;
+	      continue;
+	    }
+	  /* Missing: once for each package that is known, at least. */
+	  id_type missing = graph.target (graph.alternativeBegin (c));
+	  if (missing != PackageCollection::npos)
+	    {
+	      if (seen[missing])
+		continue;
+	      seen[missing] = true;
+	    }
+	  std::cout << db.packages[id]->name << ": "
+		    << *graph.spec (graph.alternativeBegin (c))
+		    << " (not installed)" << std::endl;
+	}
+    }
+}
+
+/* What installing the package would install with it, going by the
+   current versions; nothing is selected to find out. */
+static void
+pulls (id_type id)
+{
+  packagedb db;
+  static PackageClosure closures (TRUST_CURR);
+  if (!closures.components ())
+    closures.build ();
+  PackageClosure::Set const &closure = closures.of (id);
+  size_t pulled = 0;
+  for (id_type i = 0; i < db.packages.ids (); ++i)
+    if (i != id && closure.has (i) && db.packages[i]
+	&& !db.packages[i]->installed)
+      {
+	std::cout << db.packages[id]->name << ": "
+		  << db.packages[i]->name << std::endl;
+	++pulled;
+      }
+  if (!pulled)
+    std::cout << db.packages[id]->name << ": nothing that isn't installed"
+	      << std::endl;
+}
+
+/* The shortest chain of installed dependents from a wanted package. */
+static void
+why (id_type id)
+{
+  packagedb db;
+  packagemeta *pkg = db.packages[id];
+  if (wanted (pkg))
+    {
+      std::cout << pkg->name << ": "
+		<< (pkg->user_picked ? "picked" : "in Base") << std::endl;
+      return;
+    }
+  std::vector<id_type> parent (db.packages.ids (), PackageCollection::npos);
+  std::vector<id_type> queue (1, id);
+  parent[id] = id;
+  for (size_t next = 0; next < queue.size (); ++next)
+    {
+      DependentIndex::range r = db.dependents.find (queue[next]);
+      for (DependentIndex::const_iterator d = r.first; d != r.second; ++d)
+	{
+	  if (db.packages[d->id]->installed != d->version
+	      || parent[d->id] != PackageCollection::npos)
+	    continue;
+	  parent[d->id] = queue[next];
+	  if (!wanted (db.packages[d->id]))
+	    {
+	      queue.push_back (d->id);
+	      continue;
+	    }
+	  std::cout << pkg->name << ": ";
+	  for (id_type i = d->id; i != id; i = parent[i])
+	    std::cout << db.packages[i]->name << " -> ";
+	  std::cout << pkg->name << std::endl;
+	  return;
+	}
+    }
+  std::cout << pkg->name << ": not needed by any package picked or in Base"
+	    << std::endl;
+}
+
+int
+do_query (const std::string& query)
+{
+  std::string::size_type colon = query.find (':');
+  std::string what = query.substr (0, colon);
+  void (*answer) (id_type) = what == "rdepends" ? rdepends
+    : what == "depends" ? depends : what == "why" ? why
+    : what == "pulls" ? pulls : NULL;
+  if (colon == std::string::npos || !answer)
+    {
+      std::cout << "setup: unknown query '" << query << "', expected"
+		<< " rdepends, depends, why or pulls:package[,package...]"
+		<< std::endl;
+      return 1;
+    }
+
+  if (((std::string) RootOption).size ())
+    set_root_dir ((std::string) RootOption);
+  LocalDirSetting localDir;
+  packagedb db;
+  int files = load_ini_snapshot ();
+  if (!files)
+    {
+      std::cout << "setup: no package database snapshot in " << local_dir
+		<< ", run setup with this local package directory first"
+		<< std::endl;
+      return 1;
+    }
+  db.upgrade ();
+  Log (LOG_BABBLE) << "Query " << query << " of the packages of " << files
+		   << " setup files" << endLog;
+
+  int rv = 0;
+  std::string::size_type start = colon + 1, end;
+  do
+    {
+      end = query.find (',', start);
+      std::string name = query.substr (start, end - start);
+      start = end + 1;
+      id_type id = db.packages.id (name);
+      if (id == PackageCollection::npos || !db.packages[id])
+	{
+	  std::cout << "setup: no package " << name << std::endl;
+	  rv = 1;
+	}
+      else if ((answer == depends || answer == why)
+	       && !db.packages[id]->installed)
+	{
+	  std::cout << "setup: " << name << " is not installed" << std::endl;
+	  rv = 1;
+	}
+      else
+	answer (id);
+    }
+  while (end != std::string::npos);
+  return rv;
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#ifndef SETUP_QUERY_H
+#define SETUP_QUERY_H
+
+/* Answer questions about the installed packages on standard output,
+ * without the wizard: from installed.db and the package database snapshot
+ * the last run left in the local package directory, so nothing is
+ * downloaded or parsed.
+ *
+ * A query is 'what:package[,package...]', where what is
+ *   rdepends - the installed packages that depend on each package
+ *   depends  - all the installed packages each one needs, directly or
+ *              not, and any it needs that aren't installed
+ *   why      - why each package is installed: the chain of dependencies
+ *              from a package that was picked, or is in Base, down to it
+ *   pulls    - the packages installing each one would install as well,
+ *              those not installed yet
+ */
+
+#include <string>
+
+/* Returns the exit code: 0 if every package could be answered for. */
+int do_query (const std::string& query);
+
+#endif /* SETUP_QUERY_H */
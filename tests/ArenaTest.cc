@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+/* Allocates from an Arena: alignment, allocations larger than a block,
+   containers using an ArenaAllocator, and clear (). */
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "Arena.h"
+#include "TestCheck.h"
+
+struct Pair
+{
+  Pair (int aFirst, double aSecond) : first (aFirst), second (aSecond) {}
+  int first;
+  double second;
+};
+
+int
+main ()
+{
+  Arena arena (1024);
+
+  char *c = (char *) arena.allocate (1, 1);
+  for (size_t align = 2; align <= 64; align *= 2)
+    {
+      char *p = (char *) arena.allocate (3, align);
+      CHECK (!((uintptr_t) p % align));
+      CHECK (p > c);
+    }
+
+  Pair *pair = arena.create<Pair> (1, 2.5);
+  CHECK (!((uintptr_t) pair % alignof (Pair)));
+  CHECK (pair->first == 1 && pair->second == 2.5);
+
+  /* larger than a block, which leaves the current block in use */
+  char *big = (char *) arena.allocate (4096, 8);
+  memset (big, 'x', 4096);
+  CHECK (arena.size () >= 4096 + 1024);
+  CHECK (pair->first == 1 && pair->second == 2.5);
+  CHECK ((char *) arena.allocate (1, 1) == (char *) (pair + 1));
+
+  {
+    std::vector<int, ArenaAllocator<int> > v ((ArenaAllocator<int> (arena)));
+    for (int i = 0; i < 10000; ++i)
+      v.push_back (i);
+    for (int i = 0; i < 10000; ++i)
+      CHECK (v[i] == i);
+  }
+
+  arena.clear ();
+  CHECK (arena.size () == 0);
+  int *after = arena.create<int> (7);
+  CHECK (*after == 7 && arena.size () > 0);
+  return 0;
+}
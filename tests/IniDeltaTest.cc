@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+/* Applies a small setup.ini.delta, and checks that one made against
+   another base, or for another result, is refused. */
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "IniDelta.h"
+#include "TestCheck.h"
+
+static const std::string base =
+  "release: cygwin\n\n"
+  "@ a\nversion: 1\n\n"
+  "@ b\nversion: 1\n\n"
+  "@ c\nversion: 1\n";
+
+static const std::string header = "release: cygwin\nsetup-timestamp: 2\n\n";
+static const std::string newD = "@ d\nversion: 1\n\n";
+static const std::string newC = "@ c\nversion: 2\n";
+
+static const std::string expected =
+  header + "@ a\nversion: 1\n\n" + newD + newC;
+
+static std::string
+hex (const std::string& text)
+{
+  unsigned char d[SHA512_DIGEST_LENGTH];
+  IniDelta::digest (text, d);
+  std::string result;
+  for (size_t i = 0; i < SHA512_DIGEST_LENGTH; ++i)
+    {
+      char byte[3];
+      sprintf (byte, "%02x", d[i]);
+      result += byte;
+    }
+  return result;
+}
+
+static std::string
+block (const std::string& text)
+{
+  char size[16];
+  sprintf (size, " %u\n", (unsigned) text.size ());
+  return size + text;
+}
+
+/* A delta turning base into expected, claiming the digests given. */
+static std::string
+delta (const std::string& baseDigest, const std::string& resultDigest)
+{
+  return "setup.ini delta 1\n"
+    "base " + baseDigest + "\n"
+    "result " + resultDigest + "\n"
+    "header" + block (header) +
+    "remove b\n"
+    "replace c" + block (newC) +
+    "add a" + block (newD);
+}
+
+int
+main ()
+{
+  std::string result, changes;
+  std::vector<std::string> order;
+
+  IniDelta good;
+  CHECK (good.parse (delta (hex (base), hex (expected))));
+  CHECK (good.apply (base, result, order, changes));
+  CHECK (result == expected);
+  CHECK (order.size () == 3 && order[0] == "a" && order[1] == "d"
+	 && order[2] == "c");
+  CHECK (changes == header + newD + newC);
+
+  /* a base file the delta wasn't made against */
+  std::string other = base;
+  other[other.size () - 2] = '2';
+  CHECK (!good.apply (other, result, order, changes));
+
+  /* a delta whose result isn't the file it was made for */
+  IniDelta wrong;
+  CHECK (wrong.parse (delta (hex (base), hex (base))));
+  CHECK (!wrong.apply (base, result, order, changes));
+
+  IniDelta garbage;
+  CHECK (!garbage.parse ("setup.ini delta 2\n"));
+  CHECK (!garbage.parse (delta (hex (base), "00")));
+
+  return 0;
+}
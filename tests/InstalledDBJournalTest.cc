@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+/* Reads installed.db and replays its journal from memory, and checks that
+   the replay stops at the first record whose hash is wrong, and that what
+   is journalled after such a record isn't lost behind it. */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <map>
+#include <string>
+
+#include "cygpackage.h"
+#include "IOStreamProvider.h"
+#include "io_stream_memory.h"
+#include "NullLog.h"
+#include "package_db.h"
+#include "package_meta.h"
+#include "TestCheck.h"
+
+/* cygfile://, served from memory. */
+class MemoryFiles : public IOStreamProvider
+{
+public:
+  MemoryFiles () { io_stream::registerProvider (*this, "cygfile://"); }
+  virtual int exists (const std::string& path) const
+    { return files.count (path); }
+  virtual int remove (const std::string& path) const
+    { return !files.erase (path); }
+  virtual int mklink (const std::string&, const std::string&,
+		      io_stream_link_t) const { return 1; }
+  virtual io_stream *open (const std::string& path, const std::string& mode,
+			   mode_t) const
+  {
+    std::map<std::string, std::string>::const_iterator f = files.find (path);
+    if (mode[0] == 'w' || mode[0] == 'a')
+      return new File (files[path], mode[0] == 'a' && f != files.end ()
+		       ? f->second : std::string ());
+    if (f == files.end ())
+      return new Missing;
+    io_stream *s = new io_stream_memory;
+    s->write (f->second.data (), f->second.size ());
+    s->seek (0, IO_SEEK_SET);
+    return s;
+  }
+  virtual int move (const std::string& from, const std::string& to) const
+  {
+    if (!files.count (from))
+      return 1;
+    files[to] = files[from];
+    files.erase (from);
+    return 0;
+  }
+  virtual int mkdir_p (path_type_t, const std::string&, mode_t) const
+    { return 0; }
+
+  mutable std::map<std::string, std::string> files;
+private:
+  class Missing : public io_stream_memory
+  {
+  public:
+    virtual int error () { return ENOENT; }
+  };
+  /* A file being written, which is stored on each sync () and when it is
+     closed. */
+  class File : public io_stream_memory
+  {
+  public:
+    File (std::string &aStored, const std::string& contents) :
+      stored (aStored)
+    {
+      write (contents.data (), contents.size ());
+      sync ();
+    }
+    ~File () { sync (); }
+    virtual int sync ()
+    {
+      /* reading it all leaves it at the end, where it is written to */
+      seek (0, IO_SEEK_SET);
+      std::string contents;
+      char buf[4096];
+      ssize_t len;
+      while ((len = read (buf, sizeof buf)) > 0)
+	contents.append (buf, len);
+      stored = contents;
+      return 0;
+    }
+  private:
+    std::string &stored;
+  };
+};
+
+static MemoryFiles cygfile;
+
+/* A journal record, with the FNV-1a hash package_db.cc expects. */
+static std::string
+record (const std::string& text)
+{
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < text.size (); ++i)
+    {
+      h ^= (unsigned char) text[i];
+      h *= 16777619u;
+    }
+  char hash[16];
+  sprintf (hash, " %08x\n", h);
+  return text + hash;
+}
+
+/* The version of name installed, if any. */
+static std::string
+installed (const std::string& name)
+{
+  packagedb db;
+  packagemeta *pkg = db.packages.find (name);
+  return pkg && pkg->installed ? pkg->installed.Canonical_version ()
+    : std::string ();
+}
+
+/* Install version of the new package name, and journal that. */
+static void
+install (const std::string& name, const std::string& version)
+{
+  packagedb db;
+  packagemeta *pkg = new packagemeta (name);
+  db.packages.insert (pkg);
+  packageversion binary =
+    cygpackage::createInstance (name, version, package_installed,
+				package_binary);
+  pkg->add_version (binary);
+  pkg->set_installed (binary);
+  CHECK (!db.journal (*pkg));
+}
+
+int
+main ()
+{
+  NullLog log;
+  LogSingleton::SetInstance (log);
+
+  cygfile.files["/etc/setup/installed.db"] =
+    "INSTALLED.DB 3\n"
+    "a a-1.0-1.tar.bz2 0\n"
+    "b b-2.0-1.tar.bz2 1\n";
+  cygfile.files["/etc/setup/installed.db.journal"] =
+    record ("I c c-3.0-1.tar.bz2 0")
+    + record ("R a")
+    /* torn: neither it nor what follows is replayed */
+    + "I b b-2.1-1.tar.bz2 1 0000\n"
+    + record ("I d d-1.0-1.tar.bz2 0");
+
+  packagedb db;
+  CHECK (db.packages.size () == 2);
+  CHECK (installed ("a").empty ());
+  CHECK (installed ("b") == "2.0-1");
+  CHECK (db.packages.find ("b")->user_picked);
+  CHECK (installed ("c") == "3.0-1");
+  CHECK (installed ("d").empty ());
+
+  /* install after the torn record, then as a later run would */
+  install ("e", "1.0-1");
+  packagedb::clear (true);
+  CHECK (installed ("b") == "2.0-1");
+  CHECK (installed ("c") == "3.0-1");
+  CHECK (installed ("d").empty ());
+  CHECK (installed ("e") == "1.0-1");
+
+  /* and after a whole journal */
+  install ("f", "2.0-1");
+  CHECK (cygfile.files["/etc/setup/installed.db.journal"]
+	 == record ("I f f-2.0-1.tar.bz2 0"));
+  packagedb::clear (true);
+  CHECK (installed ("e") == "1.0-1");
+  CHECK (installed ("f") == "2.0-1");
+  return 0;
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+/* Inserts, looks up, erases and iterates over packages in a
+   PackageCollection: erasing from the middle of probe runs, one of them
+   wrapping around the end of the table, and enough packages for the
+   table to grow. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "PackageCollection.h"
+#include "package_meta.h"
+#include "TestCheck.h"
+
+/* The names of the packages in the collection, in iteration order. */
+static std::string
+names (PackageCollection &packages)
+{
+  std::string result;
+  for (PackageCollection::iterator i = packages.begin ();
+       i != packages.end (); ++i)
+    {
+      CHECK (i->first == i->second->name);
+      CHECK (packages[packages.id (i->first)] == i->second);
+      result += i->first + " ";
+    }
+  return result;
+}
+
+/* The slot a name hashes to in the first table, of 64 slots, as
+   PackageCollection::hash () works it out. */
+static size_t
+home (const std::string& name)
+{
+  uint32_t h = 2166136261U;
+  for (size_t i = 0; i < name.size (); ++i)
+    {
+      h ^= (unsigned char) name[i];
+      h *= 16777619U;
+    }
+  return h & 63;
+}
+
+/* Add count new packages whose names hash to slot to packages. */
+static void
+collide (size_t slot, size_t count, std::vector<packagemeta *> &packages)
+{
+  for (int n = 0; count; ++n)
+    {
+      char name[16];
+      sprintf (name, "q%d", n);
+      if (home (name) == slot)
+	{
+	  packages.push_back (new packagemeta (name));
+	  --count;
+	}
+    }
+}
+
+int
+main ()
+{
+  PackageCollection packages;
+  packagemeta b ("b"), a ("a"), c ("c"), otherB ("b");
+
+  CHECK (packages.empty ());
+  std::pair<PackageCollection::id_type, bool> inserted = packages.insert (&b);
+  CHECK (inserted.first == 0 && inserted.second);
+  CHECK (packages.insert (&a).first == 1);
+  CHECK (packages.insert (&c).first == 2);
+  inserted = packages.insert (&otherB);
+  CHECK (inserted.first == 0 && !inserted.second);
+  CHECK (packages.size () == 3 && packages.ids () == 3);
+  CHECK (packages.find ("b") == &b && packages.id ("c") == 2);
+  CHECK (!packages.find ("d") && packages.id ("d") == PackageCollection::npos);
+  CHECK (names (packages) == "a b c ");
+
+  /* erasing while iterating, as with a std::map */
+  for (PackageCollection::iterator i = packages.begin ();
+       i != packages.end ();)
+    if (i->first == "b")
+      packages.erase (i++);
+    else
+      ++i;
+  CHECK (names (packages) == "a c ");
+  CHECK (!packages.find ("b") && packages.size () == 2
+	 && packages.ids () == 3);
+
+  /* Probe runs, in the table of 64 slots that is kept until 32 packages:
+     five packages hashing to slot 10, and four to slot 62 followed by two
+     to slot 0, a run that wraps around to slot 3. */
+  std::vector<packagemeta *> runs;
+  collide (10, 5, runs);
+  collide (62, 4, runs);
+  collide (0, 2, runs);
+  for (size_t r = 0; r < runs.size (); ++r)
+    CHECK (packages.insert (runs[r]).second);
+  /* from the middle of each run, and the last of the first */
+  size_t gone[] = { 2, 4, 6, 9 };
+  for (size_t g = 0; g < sizeof (gone) / sizeof (*gone); ++g)
+    {
+      PackageCollection::iterator i = packages.begin ();
+      while (i->second != runs[gone[g]])
+	++i;
+      packages.erase (i);
+      runs[gone[g]] = NULL;
+      for (size_t r = 0; r < runs.size (); ++r)
+	if (runs[r])
+	  CHECK (packages.find (runs[r]->name) == runs[r]);
+      CHECK (packages.find ("a") == &a && packages.find ("c") == &c);
+    }
+  CHECK (packages.size () == 2 + runs.size () - 4);
+
+  /* enough to grow the table several times; ids are not reused */
+  std::vector<packagemeta *> more;
+  for (int n = 0; n < 1000; ++n)
+    {
+      char name[16];
+      sprintf (name, "p%04d", n);
+      more.push_back (new packagemeta (name));
+      CHECK (packages.insert (more.back ()).first == n + 3 + runs.size ());
+    }
+  for (int n = 0; n < 1000; ++n)
+    CHECK (packages.find (more[n]->name) == more[n]);
+  for (size_t r = 0; r < runs.size (); ++r)
+    if (runs[r])
+      CHECK (packages.find (runs[r]->name) == runs[r]);
+  CHECK (packages.find ("a") == &a && !packages.find ("b"));
+  CHECK (names (packages).compare (0, 4, "a c ") == 0);
+  CHECK (packages.size () == 1000 + 2 + runs.size () - 4);
+
+  packages.clear ();
+  CHECK (packages.empty () && !packages.find ("a")
+	 && packages.begin () == packages.end ());
+  for (size_t r = 0; r < runs.size (); ++r)
+    delete runs[r];
+  for (int n = 0; n < 1000; ++n)
+    delete more[n];
+  return 0;
+}
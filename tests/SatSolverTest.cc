@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+/* Solves with a SatSolver: learning from a conflict, solving under
+   assumptions, adding clauses between solves, and what is left once the
+   clauses can't be met. */
+
+#include <vector>
+
+#include "SatSolver.h"
+#include "TestCheck.h"
+
+typedef SatSolver::literal literal;
+
+static std::vector<literal>
+clause (literal a, literal b = SatSolver::noLiteral)
+{
+  std::vector<literal> c (1, a);
+  if (b != SatSolver::noLiteral)
+    c.push_back (b);
+  return c;
+}
+
+int
+main ()
+{
+  SatSolver solver;
+  SatSolver::variable a = solver.newVariable (), b = solver.newVariable (),
+    c = solver.newVariable (), d = solver.newVariable ();
+  /* exactly one of a and b */
+  solver.addClause (clause (SatSolver::positive (a), SatSolver::positive (b)));
+  solver.addClause (clause (SatSolver::negative (a), SatSolver::negative (b)));
+  /* c, which making everything false first only finds out from d */
+  solver.addClause (clause (SatSolver::positive (c), SatSolver::positive (d)));
+  solver.addClause (clause (SatSolver::positive (c), SatSolver::negative (d)));
+
+  CHECK (solver.solve ());
+  CHECK (solver.value (a) != solver.value (b));
+  CHECK (solver.value (c));
+  CHECK (solver.conflicts () > 0);
+
+  std::vector<literal> assumed (1, SatSolver::positive (a));
+  CHECK (solver.solve (assumed));
+  CHECK (solver.value (a) && !solver.value (b));
+  assumed.push_back (SatSolver::positive (b));
+  CHECK (!solver.solve (assumed));
+  /* which only held for that call */
+  CHECK (solver.solve ());
+
+  solver.addClause (clause (SatSolver::negative (a)));
+  CHECK (solver.solve ());
+  CHECK (!solver.value (a) && solver.value (b) && solver.value (c));
+  CHECK (!solver.solve (clause (SatSolver::positive (a))));
+  CHECK (solver.solve (clause (SatSolver::negative (d))));
+  CHECK (!solver.value (d));
+
+  solver.addClause (clause (SatSolver::negative (b)));
+  CHECK (!solver.solve ());
+  CHECK (!solver.solve (clause (SatSolver::positive (c))));
+  return 0;
+}
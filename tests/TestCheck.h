@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2016, Cygwin Setup contributors.
+ *
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ *
+ *     A copy of the GNU General Public License can be found at
+ *     http://www.gnu.org/
+ *
+ */
+
+#ifndef SETUP_TESTS_TESTCHECK_H
+#define SETUP_TESTS_TESTCHECK_H
+
+/* A test is a program that fails, with exit status 1, at the first check
+ * that doesn't hold.  CHECK names the condition and where it is. */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHECK(condition) \
+  check ((condition), #condition, __FILE__, __LINE__)
+
+static inline void
+check (bool ok, const char *what, const char *file, int line)
+{
+  if (ok)
+    return;
+  fprintf (stderr, "%s:%d: check failed: %s\n", file, line, what);
+  exit (1);
+}
+
+#endif /* SETUP_TESTS_TESTCHECK_H */